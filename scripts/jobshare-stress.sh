@@ -0,0 +1,64 @@
+#!/bin/sh
+# Stress test for the shared memory job table (jobshare on / jobview).
+# Starts <jobs> background jobs in one command line while jobview watches the table, then checks that
+# the table jobview prints holds the same job ids and pids as the jobs builtin lists.
+# usage: scripts/jobshare-stress.sh [path to main] [path to jobview] [jobs, default 3000]
+
+MAIN=${1:-./main}
+JOBVIEW=${2:-./jobview}
+COUNT=${3:-3000}
+DIR=$(mktemp -d)
+trap 'exec 3>&-; pkill -KILL -P "$SHELL_PID" 2> /dev/null; kill "$SHELL_PID" "$WATCH_PID" 2> /dev/null; rm -rf "$DIR"' EXIT
+
+fail(){
+	echo "FAIL: $1"
+	exit 1
+}
+
+# waits up to 30s for the pattern to show up in the file
+waitFor(){
+	for i in $(seq 300); do
+		grep -q -a -- "$2" "$1" && return 0
+		sleep 0.1
+	done
+	fail "timed out waiting for '$2' in $1"
+}
+
+# the shell reads its commands from a fifo, which is kept open so that it never sees end of file
+mkfifo "$DIR/in"
+"$MAIN" < "$DIR/in" > "$DIR/out" 2>&1 &
+SHELL_PID=$!
+exec 3> "$DIR/in"
+
+echo "jobshare on" >&3
+waitFor "$DIR/out" "Job table published"
+
+# watch the table while it fills up, every snapshot has to be consistent
+# only the snapshot headers and errors are kept, a full snapshot of the table is thousands of lines
+"$JOBVIEW" "$SHELL_PID" -w 0.2 | grep -a -e "^Shell" -e "Could not" > "$DIR/watch" &
+WATCH_PID=$!
+
+LINE=""
+for i in $(seq "$COUNT"); do LINE="$LINE sleep 600 &"; done
+echo "$LINE" >&3
+echo "jobs" >&3
+echo "echo jobs-listed" >&3
+waitFor "$DIR/out" "jobs-listed"
+"$JOBVIEW" "$SHELL_PID" > "$DIR/view"
+
+# both list '[id] ... pid', compare them as sorted 'id pid' pairs
+grep -a -o '\[[0-9]*\]   Running[[:space:]]*[0-9]*' "$DIR/out" | tr -d '[]' | awk '{print $1, $3}' | sort > "$DIR/jobs.ids"
+grep -a '^\[[0-9]*\]' "$DIR/view" | tr -d '[]' | awk '{print $1, $2}' | sort > "$DIR/view.ids"
+
+echo "exit" >&3
+wait "$SHELL_PID"
+wait "$WATCH_PID"
+
+JOBS=$(wc -l < "$DIR/jobs.ids")
+[ "$JOBS" -eq "$COUNT" ] || fail "jobs listed $JOBS jobs instead of $COUNT"
+grep -q "^Shell $SHELL_PID: $COUNT jobs" "$DIR/view" || fail "jobview did not report $COUNT jobs: $(head -1 "$DIR/view")"
+diff "$DIR/jobs.ids" "$DIR/view.ids" > /dev/null || fail "the job table differs from jobs"
+grep -q "Could not read a consistent snapshot" "$DIR/watch" && fail "jobview read an inconsistent snapshot"
+SNAPSHOTS=$(grep -c "^Shell $SHELL_PID" "$DIR/watch")
+
+echo "PASS: $COUNT jobs, table matches jobs, $SNAPSHOTS consistent snapshots taken while they started"
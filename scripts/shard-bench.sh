@@ -0,0 +1,65 @@
+#!/bin/sh
+# Scaling benchmark for the sharding pipe (|*N and |*No).
+# Runs a CPU bound awk filter over <lines> lines, once as a plain stage and once split with |*N and |*No, where N
+# is the number of cores the shell is pinned to with taskset. Prints the median of <runs> runs for each core count.
+# usage: scripts/shard-bench.sh [path to main] [lines, default 3000000] [core counts, default "1 2 4 ... nproc"] [runs, default 3]
+
+MAIN=${1:-./main}
+LINES=${2:-3000000}
+CORES=${3:-}
+RUNS=${4:-3}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+fail(){
+	echo "FAIL: $1"
+	exit 1
+}
+
+command -v taskset > /dev/null || fail "taskset is needed to pin the shell to a number of cores"
+MAX=$(nproc)
+if [ -z "$CORES" ]; then
+	c=1
+	while [ "$c" -lt "$MAX" ]; do CORES="$CORES $c"; c=$((c * 2)); done
+	CORES="$CORES $MAX"
+fi
+
+# the shell has no quoting, so the filter lives in a file of its own
+cat > "$DIR/filter.awk" << 'EOF'
+{ s = 0; for (i = 0; i < 20; i++) s += sin($1 + i) * cos($1 - i); printf "%.6f\n", s }
+EOF
+seq "$LINES" > "$DIR/input"
+
+# runs one command line in the shell pinned to the first <cores> cores, prints its wall time in milliseconds
+timeLine(){
+	printf '%s\nexit\n' "$2" > "$DIR/line"
+	start=$(date +%s%N)
+	taskset -c "0-$(($1 - 1))" "$MAIN" < "$DIR/line" > /dev/null 2>&1
+	end=$(date +%s%N)
+	echo $(((end - start) / 1000000))
+}
+
+# median of RUNS runs of timeLine
+median(){
+	for r in $(seq "$RUNS"); do timeLine "$1" "$2"; done | sort -n | sed -n "$(((RUNS + 1) / 2))p"
+}
+
+# every line has to come out of the filter, or the timing means nothing
+checkOutput(){
+	[ "$(wc -l < "$DIR/output")" -eq "$LINES" ] || fail "'$1' gave $(wc -l < "$DIR/output") lines instead of $LINES"
+	rm -f "$DIR/output"
+}
+
+echo "$LINES lines through awk, median of $RUNS runs, $MAX cores available"
+printf '%6s %10s %10s %10s %8s %8s\n' cores plain "|*N" "|*No" speedup ordered
+for c in $CORES; do
+	[ "$c" -le "$MAX" ] || fail "$c cores asked for, only $MAX are available"
+	plain=$(median "$c" "awk -f $DIR/filter.awk < $DIR/input > $DIR/output")
+	checkOutput "awk"
+	shard=$(median "$c" "cat $DIR/input |*$c awk -f $DIR/filter.awk > $DIR/output")
+	checkOutput "|*$c awk"
+	ordered=$(median "$c" "cat $DIR/input |*${c}o awk -f $DIR/filter.awk > $DIR/output")
+	checkOutput "|*${c}o awk"
+	printf '%6s %8sms %8sms %8sms %7sx %7sx\n' "$c" "$plain" "$shard" "$ordered" \
+		"$(awk "BEGIN { printf \"%.2f\", $plain / $shard }")" "$(awk "BEGIN { printf \"%.2f\", $plain / $ordered }")"
+done
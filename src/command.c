@@ -1,8 +1,13 @@
 #include "command.h"
+#include "shard.h"
+
+extern char** environ;
+int argBatch = 0;
 
 //returns number of commands, or -1 if error
 int separateCommands(char* tokens[], Command* first){
 	int idx = 0, commandCount = 0, commandStart = 0, commandEnd = 0;
+	int shards = 0, shardOrdered = 0; //given by a |*n separator to the command after it
 	Command** current = &first;
 	
 	while (tokens[idx] != NULL){
@@ -23,8 +28,31 @@ int separateCommands(char* tokens[], Command* first){
 			//set path i.e first token into command
 			(*current)->path = tokens[commandStart];
 			
-			//set separator as first character of tokens[idx]
-			(*current)->separator = tokens[idx][0];
+			//set separator based on tokens[idx]
+			(*current)->separator = getSeparator(tokens[idx]);
+
+			//a pipe written as |=<size> asks for that capacity for this pipe only
+			(*current)->pipeSize = 0;
+			if (tokens[idx][0] == '|' && tokens[idx][1] == '='){
+				long size = parseSize(&tokens[idx][2]);
+				if (size <= 0 || size > 1024*1024*1024) return -1;
+				(*current)->pipeSize = (int) size;
+			}
+
+			//a pipe written as |+ sends the output of the stage feeding it to the commands on both of its sides
+			(*current)->fanOut = (strcmp(tokens[idx], "|+") == 0) ? 1 : 0;
+
+			//a pipe written as |*n, or |*no to keep the order of the lines, runs n copies of the next command
+			(*current)->shards = shards;
+			(*current)->shardOrdered = shardOrdered;
+			shards = shardOrdered = 0;
+			if (tokens[idx][0] == '|' && tokens[idx][1] == '*'){
+				char* end;
+				shards = (int) strtol(&tokens[idx][2], &end, 10);
+				if (strcmp(end, "o") == 0) shardOrdered = 1;
+				else if (*end != '\0') return -1;
+				if (shards <= 0 || shards > MAX_SHARDS) return -1;
+			}
 			
 			(*current)->nextCmd = NULL;
 
@@ -48,6 +76,13 @@ int isSeparator(char token){
 	return 0;
 }
 
+//return the separator value for a token, the two character operators get their own values
+char getSeparator(char* token){
+	if (strcmp(token, "&&") == 0) return SEP_AND;
+	if (strcmp(token, "||") == 0) return SEP_OR;
+	return token[0];
+}
+
 //search a command for the presence of a redirection symbol < or >
 void searchRedirection(char *token[], Command *cp, int first, int last){
 	//set both stdin_file and stdout_file to null first
@@ -57,69 +92,167 @@ void searchRedirection(char *token[], Command *cp, int first, int last){
 	if (first != last){
 		//if the symbols are encountered, add the argument after the symbol to stdin or stdout_file
 		for (int i=first+1; i<=last; i++){
-			if (strcmp(token[i],"<") == 0 && i != last) cp->stdin_file = token[i+1];
-			if (strcmp(token[i],">") == 0 && i != last) cp->stdout_file = token[i+1];
+			//the names are copied, as the command frees them (and expandArguments replaces them)
+			if (strcmp(token[i],"<") == 0 && i != last) {free(cp->stdin_file); cp->stdin_file = strdup(token[i+1]);}
+			if (strcmp(token[i],">") == 0 && i != last) {free(cp->stdout_file); cp->stdout_file = strdup(token[i+1]);}
 		}
 	}
 }
 
-void buildCommandArgumentArray(char *token[], Command *cp, int first, int last){
-	char* arguments[MAX_NUMBER_ARGUMENTS];
+//makes room in a heap grown argument vector for at least needed pointers, growing it geometrically
+static char** growArguments(char** arguments, int* capacity, int needed){
+	if (needed <= *capacity) return arguments;
+	while (*capacity < needed) *capacity *= 2;
+	arguments = (char**) realloc(arguments, sizeof(char*) * (*capacity));
+	if (arguments == NULL) {
+		perror("Failure to assign memory for arguments using realloc.\n");
+		exit(1);
+	}
+	return arguments;
+}
+
+//adds arg to the arguments, or the paths it matches if it has wildcards, remaining is the number of arguments
+//that may still follow it, returns 1 if arg was replaced by the paths it matched, 0 if it was copied
+static int addArgument(char*** arguments, int* capacity, int* noArguments, char* arg, int remaining, Command* cp, int* largest){
 	glob_t temp;
-	int noArguments = 0, res;
+	int res, globbed = 0;
+
+	//first check if a wildcard character exists in the token
+	if (strchr(arg, '*') != NULL || strchr(arg, '?') != NULL || strchr(arg, '[') != NULL){
+		//if it exists, that means we glob it
+		//dynamically create a separate char* string so that arg isn't erased
+		char* tempTok = strdup(arg);
+
+		//glob stores result in temp struct, which has temp.argc (number of paths) and temp.argv (array of path names)
+		res = glob(tempTok, GLOB_TILDE, NULL, &temp);
+		if (res == 0){
+			//the arguments after this one still need their space, along with the NULL pointer
+			*arguments = growArguments(*arguments, capacity, *noArguments + temp.gl_pathc + remaining + 1);
+			if (temp.gl_pathc > *largest){
+				*largest = temp.gl_pathc;
+				cp->batchFirst = *noArguments;
+				cp->batchLast = *noArguments + temp.gl_pathc - 1;
+			}
+			for (int j = 0; j < temp.gl_pathc; j++){
+				(*arguments)[*noArguments] = strdup(temp.gl_pathv[j]);
+				(*noArguments)++;
+			} //copying over each valid path into arguments
+			globfree(&temp); //free the glob structure, the paths were copied
+			globbed = 1;
+		} else if (res == GLOB_NOMATCH) { //if there's no valid path matched, then copy the same token over
+			(*arguments)[*noArguments] = strdup(arg);
+			(*noArguments)++;
+		} //additional error handling
+		free(tempTok); //free the tempTok
+	} else {
+		(*arguments)[*noArguments] = strdup(arg);
+		(*noArguments)++;
+	}
+	return globbed;
+}
+
+void buildCommandArgumentArray(char *token[], Command *cp, int first, int last){
+	//the arguments are collected straight into argv, grown on the heap as a glob can match any number of paths
+	int capacity = last - first + 2, noArguments = 0;
+	char** arguments = (char**) malloc(sizeof(char*) * capacity);
+	if (arguments == NULL) {
+		perror("Failure to assign memory for arguments using realloc.\n");
+		exit(1);
+	}
 
 	//copy first token (path) into arguments as path
-	arguments[noArguments] = token[first];
+	arguments[noArguments] = strdup(token[first]);
 	noArguments++;
+
+	//if argbatch splits the command, it splits the largest glob expansion, or every argument when there is none
+	cp->batchFirst = 1;
+	cp->batchLast = -1;
+	int largest = 0;
+
+	//a command using variables is expanded and globbed once it runs instead (expandArguments)
+	cp->expand = 0;
+	for (int i = first; i<=last; i++){
+		if (strchr(token[i], '$') != NULL) cp->expand = 1;
+	}
 		
 	//go through each token, check for redirection (skip them)
 	//also check if token has wildcards with glob (if so, iterate and add to arguments array
 	for (int i = first+1; i<=last; i++){
 		if (strcmp(token[i], "<") == 0 || strcmp(token[i], ">") == 0){
 			i++; //skip the redirection symbol and its location
-		} else {
-			//first check if a wildcard character exists in the token
-			if (strchr(token[i], '*') != NULL || strchr(token[i], '?') != NULL || strchr(token[i], '[') != NULL){
-				//if it exists, that means we glob it
-				//dynamically create a separate char* string so that token[i] isn't erased
-				char* tempTok = strdup(token[i]);
-
-				//glob stores result in temp struct, which has temp.argc (number of paths) and temp.argv (array of path names)
-				res = glob(tempTok, GLOB_TILDE, NULL, &temp);
-				if (res == 0){
-					free(token[i]); 
-					//no longer used, so free it as it won't be freed later in freeResources via freeing each command
-					for (int j = 0; j < temp.gl_pathc; j++){
-						arguments[noArguments] = temp.gl_pathv[j];
-						noArguments++;
-					} //copying over each valid path into arguments
-				} else if (res == GLOB_NOMATCH) { //if there's no valid path matched, then copy the same token over
-					arguments[noArguments] = token[i];
-					noArguments++;
-				} //additional error handling
-				free(tempTok); //free the tempTok
-			} else {
-				arguments[noArguments] = token[i];
-				noArguments++;
-			} //additional error handling
-		}		
+		} else if (cp->expand == 1){
+			arguments[noArguments] = strdup(token[i]);
+			noArguments++;
+		} else if (addArgument(&arguments, &capacity, &noArguments, token[i], last - i, cp, &largest) == 1){
+			free(token[i]); 
+			//no longer used, so free it as it won't be freed later in freeResources via freeing each command
+		}
 	}
 	cp->argc = noArguments;
+	if (cp->batchLast == -1) cp->batchLast = noArguments-1;
+
+	cp->argv = arguments; //capacity always leaves one space for the NULL pointer as the last argument
+	cp->argv[noArguments] = NULL;
+}
 
-	//malloc argv of command to the size of actual arguments found	
-	cp->argv = (char**) malloc((sizeof(char*) * noArguments)+1); //additional 1 space for the NULL pointer as the last argument
-	if (cp->argv == NULL) {
+void expandArguments(Command* cp, int status){
+	int capacity = cp->argc + 1, noArguments = 0, largest = 0;
+	char** arguments = (char**) malloc(sizeof(char*) * capacity);
+	if (arguments == NULL) {
 		perror("Failure to assign memory for arguments using realloc.\n");
 		exit(1);
 	}
+	cp->batchFirst = 1;
+	cp->batchLast = -1;
 
-	//copy over arguments
-	for(int k = 0; k < noArguments; k++){
-			cp->argv[k] = strdup(arguments[k]);
+	//variables are replaced first and wildcards globbed after, so that 'ls $DIR/*' lists the directory
+	for (int i = 0; i<cp->argc; i++){
+		char* arg = expandVariables(cp->argv[i], status);
+		if (arg[0] == '\0' && cp->argv[i][0] == '$' && i > 0){
+			//an argument made of a variable that is empty or not set is left out, like an unquoted one in sh
+		} else if (i == 0){
+			arguments[noArguments] = strdup(arg); //the path is never globbed
+			noArguments++;
+		} else {
+			addArgument(&arguments, &capacity, &noArguments, arg, cp->argc - 1 - i, cp, &largest);
+		}
+		free(arg);
+		free(cp->argv[i]);
 	}
+	free(cp->argv);
+
+	cp->argc = noArguments;
+	if (cp->batchLast == -1) cp->batchLast = noArguments-1;
+	cp->argv = arguments;
 	cp->argv[noArguments] = NULL;
+	cp->path = cp->argv[0];
+
+	if (cp->stdin_file != NULL && strchr(cp->stdin_file, '$') != NULL){
+		char* file = expandVariables(cp->stdin_file, status);
+		free(cp->stdin_file);
+		cp->stdin_file = file;
+	}
+	if (cp->stdout_file != NULL && strchr(cp->stdout_file, '$') != NULL){
+		char* file = expandVariables(cp->stdout_file, status);
+		free(cp->stdout_file);
+		cp->stdout_file = file;
+	}
+	cp->expand = 0;
+}
 
-	globfree(&temp); //free the glob structure
+void dropArguments(Command* cp, int cnt){
+	for (int i=0; i<cnt; i++) free(cp->argv[i]);
+	memmove(cp->argv, &cp->argv[cnt], sizeof(char*) * (cp->argc - cnt + 1)); //along with the NULL terminator
+	cp->argc -= cnt;
+	cp->path = cp->argv[0];
+
+	//the batched range moves along with the arguments, and is all of them if it was in the part removed
+	cp->batchFirst -= cnt;
+	cp->batchLast -= cnt;
+	if (cp->batchFirst < 1 || cp->batchLast < cp->batchFirst){
+		cp->batchFirst = 1;
+		cp->batchLast = cp->argc-1;
+	}
 }
 
 //set all members of cp to empty/null values
@@ -130,6 +263,13 @@ void initializeCommand(Command* cp){
 	cp->argv = NULL;
 	cp->stdin_file = NULL;
 	cp->stdout_file = NULL;
+	cp->pipeSize = 0;
+	cp->fanOut = 0;
+	cp->expand = 0;
+	cp->shards = 0;
+	cp->shardOrdered = 0;
+	cp->batchFirst = 1;
+	cp->batchLast = 0;
 	cp->nextCmd = NULL;
 }
 
@@ -153,12 +293,192 @@ void executeCommand(Command* cp){
 	}	
 
 	//call execvp with command
+	traceEvent(TRACE_EXEC, getpid(), getpgrp(), cp->path);
+	if (argBatch > 0 && argumentSize(cp->argv, 0, cp->argc-1) > argumentLimit()) runBatches(cp);
 	execvp(cp->path, cp->argv);
 	//following executes only if there was an error and process was not terminated
-	printf("Failed to execute command '%s'.\n", cp->path);
+	if (errno == E2BIG) printf("Argument list too long for '%s', 'argbatch on' runs it in batches.\n", cp->path);
+	else printf("Failed to execute command '%s'.\n", cp->path);
 	exit(1);
 }
 
+long argumentSize(char** argv, int first, int last){
+	//the kernel counts every string with its terminator, along with the pointer to it
+	long size = 0;
+	for (int i=first; i<=last; i++) size += strlen(argv[i]) + 1 + sizeof(char*);
+	return size;
+}
+
+long argumentLimit(){
+	long limit = sysconf(_SC_ARG_MAX);
+	if (limit <= 0) limit = 128*1024; //the historical ARG_MAX
+
+	int envCnt = 0;
+	while (environ[envCnt] != NULL) envCnt++;
+
+	//keep the same 2 KiB of headroom as xargs, the kernel adds a few values of its own to the stack
+	return limit - argumentSize(environ, 0, envCnt-1) - sizeof(char*) * 2 - 2048;
+}
+
+void runBatches(Command* cp){
+	//the shell's handler is inherited until exec, and would reap the batches before wait does
+	signal(SIGCHLD, SIG_DFL);
+
+	//every batch gets the arguments before and after the batched range, and as many of that range as fit
+	long fixedSize = argumentSize(cp->argv, 0, cp->batchFirst-1) + argumentSize(cp->argv, cp->batchLast+1, cp->argc-1);
+	long limit = argumentLimit();
+	char** argv = (char**) malloc(sizeof(char*) * (cp->argc + 1));
+	if (argv == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	for (int i=0; i<cp->batchFirst; i++) argv[i] = cp->argv[i];
+
+	int next = cp->batchFirst, active = 0, failed = 0;
+	while (next <= cp->batchLast || active > 0){
+		if (next <= cp->batchLast && active < argBatch){
+			int cnt = cp->batchFirst;
+			long size = fixedSize;
+			//at least one argument goes into each batch, exec reports it if even that is too long
+			while (next <= cp->batchLast && (cnt == cp->batchFirst || size + argumentSize(cp->argv, next, next) <= limit)){
+				size += argumentSize(cp->argv, next, next);
+				argv[cnt++] = cp->argv[next++];
+			}
+			for (int i=cp->batchLast+1; i<cp->argc; i++) argv[cnt++] = cp->argv[i];
+			argv[cnt] = NULL;
+
+			pid_t pid = fork();
+			if (pid == 0){
+				execvp(cp->path, argv);
+				if (errno == E2BIG) printf("Argument list too long for '%s'.\n", cp->path);
+				else printf("Failed to execute command '%s'.\n", cp->path);
+				exit(1);
+			} else if (pid < 0){
+				printf("Error executing command.\n");
+				failed = 1;
+				break;
+			}
+			active++;
+		} else {
+			//a batch has to finish before the next one can start
+			int status;
+			if (wait(&status) == -1) break;
+			active--;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+		}
+	}
+	while (active > 0 && wait(NULL) > 0) active--;
+
+	//like xargs, 123 tells that at least one of the batches failed
+	exit((failed == 1) ? 123 : 0);
+}
+
+void fanOutCommands(Command** cp, int fdInput){
+	//the consumers are the command after the producer and every command following a |+ after it
+	//the last one carries on with the rest of the pipeline, the others write to the shell's stdout
+	int cnt = 1;
+	Command* last = (*cp)->nextCmd;
+	while (last->fanOut == 1 && last->separator == '|' && last->nextCmd != NULL){
+		last = last->nextCmd;
+		cnt++;
+	}
+
+	int* fdOut = (int*) malloc(sizeof(int) * cnt);
+	int* fdConsumer = (int*) malloc(sizeof(int) * cnt);
+	int fdProducer[2];
+	if (fdOut == NULL || fdConsumer == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	int size = ((*cp)->pipeSize > 0) ? (*cp)->pipeSize : pipeSize;
+
+	//one pipe from the producer into the fan out process, and one from it to each consumer
+	if (pipe(fdProducer) == -1){
+		printf("Error duplicating pipe.\n");
+		exit(1);
+	}
+	setPipeSize(fdProducer[1], size);
+	for (int i=0; i<cnt; i++){
+		int fdPipe[2];
+		if (pipe(fdPipe) == -1){
+			printf("Error duplicating pipe.\n");
+			exit(1);
+		}
+		setPipeSize(fdPipe[1], size);
+		fdConsumer[i] = fdPipe[0];
+		fdOut[i] = fdPipe[1];
+	}
+
+	//producer
+	pid_t pid = fork();
+	if (pid == 0){
+		close(fdProducer[0]);
+		for (int i=0; i<cnt; i++) {close(fdConsumer[i]); close(fdOut[i]);}
+		if (dup2(fdInput, STDIN_FILENO) == -1 || dup2(fdProducer[1], STDOUT_FILENO) == -1){
+			printf("Error duplicating file descriptor.\n");
+			exit(1);
+		}
+		runStage(*cp);
+	} else if (pid < 0){
+		printf("Error forking pipe.\n");
+		exit(1);
+	}
+	traceEvent(TRACE_FORK, pid, getpgrp(), (*cp)->path);
+	close(fdProducer[1]);
+	close(fdInput);
+
+	//the fan out process, metered as the output of the producer
+	Meter* m = NULL;
+	if (meters != NULL){
+		m = &meters[meterStage];
+		snprintf(m->name, METER_LENGTH_NAME, "%s", (*cp)->path);
+	}
+	pid = fork();
+	if (pid == 0){
+		for (int i=0; i<cnt; i++) close(fdConsumer[i]);
+		fanOutPipe(fdProducer[0], fdOut, cnt, m);
+		_exit(0); //no exit(), the stdio buffers copied from the shell must not be flushed twice
+	} else if (pid < 0){
+		printf("Error forking pipe.\n");
+		exit(1);
+	}
+	close(fdProducer[0]);
+	for (int i=0; i<cnt; i++) close(fdOut[i]);
+	meterStage++;
+
+	//every consumer but the last, which write to the shell's stdout and have no meter of their own
+	Command* consumer = (*cp)->nextCmd;
+	for (int i=0; i<cnt-1; i++){
+		pid = fork();
+		if (pid == 0){
+			for (int j=0; j<cnt; j++){
+				if (j != i) close(fdConsumer[j]);
+			}
+			if (dup2(fdConsumer[i], STDIN_FILENO) == -1){
+				printf("Error duplicating file descriptor.\n");
+				exit(1);
+			}
+			runStage(consumer);
+		} else if (pid < 0){
+			printf("Error forking pipe.\n");
+			exit(1);
+		}
+		traceEvent(TRACE_FORK, pid, getpgrp(), consumer->path);
+		close(fdConsumer[i]);
+		consumer = consumer->nextCmd;
+		meterStage++;
+	}
+
+	//this process goes on with the last consumer and whatever follows it
+	int fdLast = fdConsumer[cnt-1];
+	free(fdOut);
+	free(fdConsumer);
+	pipeCommands(&last, fdLast);
+}
+
+void runStage(Command* cp){
+	if (cp->shards > 0){
+		//the handler inherited from the shell would reap the copies before the engine gets their status
+		signal(SIGCHLD, SIG_DFL);
+		_exit(runShards(cp)); //no exit(), the stdio buffers copied from the shell must not be flushed twice
+	}
+	executeCommand(cp);
+}
+
 //recursive piping 
 void pipeCommands(Command** cp, int fdInput){
 	//terminating condition : separator is not a pipe, or theres no commands following the current command
@@ -168,7 +488,9 @@ void pipeCommands(Command** cp, int fdInput){
 			printf("Error duplicating file descriptor.\n");
 			exit(1);
 		}					
-		executeCommand((*cp));
+		runStage((*cp));
+	} else if ((*cp)->fanOut == 1){
+		fanOutCommands(cp, fdInput);
 	} else {
 		//create a pipe
 		int fdPipe[2];
@@ -176,10 +498,44 @@ void pipeCommands(Command** cp, int fdInput){
 			printf("Error duplicating pipe.\n");
 			exit(1);
 		} else {
+			//the capacity given with |=<size> takes precedence over the one set with the pipesize builtin
+			int size = ((*cp)->pipeSize > 0) ? (*cp)->pipeSize : pipeSize;
+			setPipeSize(fdPipe[1], size);
+			int fdOut = fdPipe[1]; //the current command writes here
+
+			//when the pipeline is metered, the current command writes into a pipe of its own instead and
+			//a relay process forwards its output to the next command, counting the bytes on the way
+			if (meters != NULL){
+				int fdMeter[2];
+				if (pipe(fdMeter) == -1){
+					printf("Error duplicating pipe.\n");
+					exit(1);
+				}
+				setPipeSize(fdMeter[1], size);
+				snprintf(meters[meterStage].name, METER_LENGTH_NAME, "%s", (*cp)->path);
+
+				pid_t relay = fork();
+				if (relay == 0){
+					close(fdMeter[1]);
+					close(fdPipe[0]);
+					close(fdInput);
+					relayPipe(fdMeter[0], fdPipe[1], &meters[meterStage]);
+					_exit(0); //no exit(), the stdio buffers copied from the shell must not be flushed twice
+				} else if (relay < 0){
+					printf("Error forking pipe.\n");
+					exit(1);
+				}
+				close(fdMeter[0]);
+				close(fdPipe[1]);
+				fdOut = fdMeter[1];
+			}
+			meterStage++;
+
 			//fork and let parent call pipeCommands with the next command recursively
 			pid_t pid = fork();
 			if (pid > 0){ //parent executes next command, closes write and fdInput
-				close(fdPipe[1]);
+				traceEvent(TRACE_FORK, pid, getpgrp(), (*cp)->path);
+				close(fdOut);
 				close(fdInput);
 				
 				cp = &(*cp)->nextCmd;
@@ -192,12 +548,12 @@ void pipeCommands(Command** cp, int fdInput){
 					printf("Error duplicating file descriptor.\n");
 					exit(1);
 				} //read from fdInput parameter
-				if (dup2(fdPipe[1], STDOUT_FILENO) == -1){
+				if (dup2(fdOut, STDOUT_FILENO) == -1){
 					printf("Error duplicating file descriptor.\n");
 					exit(1);
 				}	//duplicate output from pipe
 	
-				executeCommand((*cp));
+				runStage((*cp));
 			} else {
 				printf("Error forking pipe.\n");
 				exit(1);
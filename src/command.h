@@ -13,41 +13,85 @@
 #include <fcntl.h>
 #include <pwd.h>
 
-#define MAX_NUMBER_ARGUMENTS 100*1000
+#include "trace.h"
+#include "limit.h"
+#include "pipeline.h"
+#include "var.h"
+
+
+#define SEP_AND 'A' //separator value stored for the "&&" token
+#define SEP_OR 'O' //separator value stored for the "||" token
 
 typedef struct CommandStructure {
     char* path;			// the path of the executable for command
     char separator;     // the command separator that follows the command. It should be 
                         // one of the following
                         //  "|"   - pipe  to the next command
+                        //  "|+"  - pipe to the next command and the one after it as well (fanOut)
+                        //  "|*n" - pipe to n copies of the next command, that get its lines in turn (shards)
                         //  "&"   - shell does not wait for this command
                         //  ";"   - shell wait for this command
+                        //  "&&"  - shell waits, next command runs only if this one succeeded (SEP_AND)
+                        //  "||"  - shell waits, next command runs only if this one failed (SEP_OR)
 						// the last command will automatically be given a sequential ';' separator
 	int argc;			// the number of arguments
     char **argv;        // an array of tokens that forms a command
     char *stdin_file;   // if not NULL, points to the file name for stdin redirection                        
     char *stdout_file;  // if not NULL, points to the file name for stdout redirection 
+    int pipeSize;       // capacity requested for the pipe after this command with "|=<size>", 0 if not given
+    int fanOut;         // 1 if the separator was "|+", the separator itself is stored as '|'
+    int batchFirst;     // range of argv that argbatch splits across several execs, the largest glob expansion
+    int batchLast;      // or every argument after the path when nothing was globbed
+    int expand;         // 1 if the command uses variables, its argv is then expanded and globbed when it runs
+    int shards;         // number of copies the command runs as when it follows "|*n", 0 if it runs once
+    int shardOrdered;   // 1 if it follows "|*no", the output of the copies then keeps the order of the input
 	struct CommandStructure* nextCmd;   // type name for the command structure
 } Command;
 
+extern int argBatch; //set with the argbatch builtin, 0 execs argv as is, otherwise the number of batches run at once
+
 //returns number of commands, or -1 if error
 int separateCommands(char* tokens[], Command* first);
 
 //returns 1 if a token is one of three separators, 0 otherwise
 int isSeparator(char token);
 
+//returns the separator value to store for a separator token, mapping "&&" and "||" to SEP_AND and SEP_OR
+char getSeparator(char* token);
+
 //sets stdin_file and stdout_file to relevant streams based on redirection symbols found
 void searchRedirection(char *token[], Command *cp, int first, int last); 
 
 //dynamically allocates array of char pointers to command's argv char** variable
 void buildCommandArgumentArray(char *token[], Command *cp, int first, int last); 
 
+//replaces the variables in the arguments and redirections of cp, then globs the arguments, $? expands to status
+void expandArguments(Command* cp, int status);
+
+//removes the first cnt arguments of cp, so that argv[cnt] becomes its path
+void dropArguments(Command* cp, int cnt);
+
 //sets all values in a CommandStructure to default values
 void initializeCommand(Command* cp);
 
 //execute the command argument
 void executeCommand(Command* cp);
 
+//returns the space argv takes in an exec, as counted against ARG_MAX
+long argumentSize(char** argv, int first, int last);
+
+//returns the space left for arguments in an exec, which is ARG_MAX less the environment
+long argumentLimit();
+
+//runs cp as several execs that each fit into ARG_MAX, like xargs, argBatch of them at a time, then exits
+void runBatches(Command* cp);
+
+//runs a stage of a pipeline in this process, which either execs it or feeds its copies when it is sharded
+void runStage(Command* cp);
+
 //recursive pipe function used to execute a series of commands connected by pipe
 void pipeCommands(Command** cp, int fdInput);
+
+//runs the producer *cp of a fan out (|+) with its consumers, then carries on with the pipeline after the last consumer
+void fanOutCommands(Command** cp, int fdInput);
 #endif
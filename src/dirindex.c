@@ -0,0 +1,208 @@
+#define _GNU_SOURCE //needed for strcasestr
+#include "dirindex.h"
+#include <errno.h>
+
+DirIndex* dirIndex = NULL; //NULL while the index could not be mapped
+int dirIndexFd = -1;
+
+//a directory matching a query, with the score it was ranked by
+typedef struct DirMatch {
+	double score;
+	DirEntry* entry;
+} DirMatch;
+
+//an entry has to be an absolute path that ends within it, as lookups rely on both
+//the file is shared, so an entry written wrong by another shell is skipped rather than trusted
+static int validEntry(DirEntry* e){
+	return (e->path[0] == '/' && memchr(e->path, '\0', DIRINDEX_LENGTH_PATH) != NULL) ? 1 : 0;
+}
+
+int initDirIndex(char* home){
+	char path[4096];
+	if (snprintf(path, 4096, "%s/%s", home, DIRINDEX_FILE) >= 4096) return -1;
+
+	//close on exec so that jobs don't inherit it
+	dirIndexFd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (dirIndexFd == -1) return -1;
+	flock(dirIndexFd, LOCK_EX);
+
+	//a new file is zero filled by ftruncate, any other size is not an index of this layout
+	struct stat st;
+	int valid = (fstat(dirIndexFd, &st) == 0) ? 1 : 0;
+	if (valid == 1 && st.st_size == 0 && ftruncate(dirIndexFd, sizeof(DirIndex)) == -1) valid = 0;
+	else if (valid == 1 && st.st_size != 0 && st.st_size != sizeof(DirIndex)) valid = 0;
+
+	DirIndex* index = MAP_FAILED;
+	if (valid == 1) index = mmap(NULL, sizeof(DirIndex), PROT_READ | PROT_WRITE, MAP_SHARED, dirIndexFd, 0);
+	if (index == MAP_FAILED) valid = 0;
+	else if (index->magic == 0 && index->count == 0) index->magic = DIRINDEX_MAGIC;
+
+	//the file is used as is afterwards, so check that it can't make a lookup read past an entry
+	if (valid == 1 && (index->magic != DIRINDEX_MAGIC || index->count < 0 || index->count > DIRINDEX_CAPACITY)) valid = 0;
+	for (int i=0; valid == 1 && i<index->count; i++){
+		if (validEntry(&index->entries[i]) == 0) valid = 0;
+	}
+
+	flock(dirIndexFd, LOCK_UN);
+	if (valid == 0){
+		if (index != MAP_FAILED) munmap(index, sizeof(DirIndex));
+		close(dirIndexFd);
+		dirIndexFd = -1;
+		return -1;
+	}
+	dirIndex = index;
+	return 0;
+}
+
+//ranks the entry higher the more recently it was visited, like z does
+static double frecency(DirEntry* e, long now){
+	long age = now - e->last;
+	if (age < 3600) return e->rank * 4;
+	if (age < 86400) return e->rank * 2;
+	if (age < 604800) return e->rank / 2;
+	return e->rank / 4;
+}
+
+//the last entry takes the place of the removed one, as the entries are kept in no particular order
+static void removeEntry(int idx){
+	dirIndex->totalRank -= dirIndex->entries[idx].rank;
+	dirIndex->count--;
+	if (idx < dirIndex->count) dirIndex->entries[idx] = dirIndex->entries[dirIndex->count];
+}
+
+//scales every rank down, so that directories no longer visited make way for the ones that are
+static void ageEntries(){
+	for (int i=dirIndex->count-1; i>=0; i--){
+		dirIndex->entries[i].rank *= 0.9;
+		if (dirIndex->entries[i].rank < 1) removeEntry(i);
+	}
+
+	dirIndex->totalRank = 0;
+	for (int i=0; i<dirIndex->count; i++) dirIndex->totalRank += dirIndex->entries[i].rank;
+}
+
+void dirIndexVisit(char* dir){
+	if (dirIndex == NULL || strlen(dir) >= DIRINDEX_LENGTH_PATH) return;
+	flock(dirIndexFd, LOCK_EX);
+
+	long now = time(NULL);
+	DirEntry* e = NULL;
+	for (int i=0; i<dirIndex->count && e == NULL; i++){
+		if (strcmp(dirIndex->entries[i].path, dir) == 0) e = &dirIndex->entries[i];
+	}
+
+	if (e == NULL){
+		//when the index is full, the directory with the lowest score is forgotten
+		if (dirIndex->count == DIRINDEX_CAPACITY){
+			int lowest = 0;
+			for (int i=1; i<dirIndex->count; i++){
+				if (frecency(&dirIndex->entries[i], now) < frecency(&dirIndex->entries[lowest], now)) lowest = i;
+			}
+			removeEntry(lowest);
+		}
+		e = &dirIndex->entries[dirIndex->count];
+		strcpy(e->path, dir);
+		e->rank = 0;
+		dirIndex->count++;
+	}
+
+	e->rank += 1;
+	e->last = now;
+	dirIndex->totalRank += 1;
+	if (dirIndex->totalRank > DIRINDEX_AGING) ageEntries();
+	flock(dirIndexFd, LOCK_UN);
+}
+
+//smart case, a term is only matched case sensitively if it has an upper case letter
+static char* findTerm(char* text, char* term){
+	for (char* c = term; *c != '\0'; c++){
+		if (*c >= 'A' && *c <= 'Z') return strstr(text, term);
+	}
+	return strcasestr(text, term);
+}
+
+//returns 1 if the terms are found in the path in the order they were given, 0 otherwise
+static int matchEntry(DirEntry* e, char** terms, int cnt){
+	if (validEntry(e) == 0) return 0;
+	char* pos = e->path;
+	char* base = strrchr(e->path, '/') + 1;
+
+	if (cnt == 0) return 1;
+
+	//most entries fail on the last term, which only has to be looked for near the end of the path
+	int lastLen = strlen(terms[cnt-1]);
+	char* tail = (base - e->path >= lastLen) ? base - lastLen + 1 : e->path;
+	if (findTerm(tail, terms[cnt-1]) == NULL) return 0;
+
+	for (int i=0; i<cnt; i++){
+		int len = strlen(terms[i]);
+		char* found = findTerm(pos, terms[i]);
+		//the last term has to reach into the last component, so that "src" picks .../src rather than .../src/lib
+		while (i == cnt-1 && found != NULL && found + len <= base) found = findTerm(found+1, terms[i]);
+		if (found == NULL) return 0;
+		pos = found + len;
+	}
+	return 1;
+}
+
+int dirIndexJump(char** terms, int cnt){
+	if (dirIndex == NULL || cnt == 0) return -1;
+	flock(dirIndexFd, LOCK_EX);
+
+	//the current directory is left out, so that repeating a jump moves on to the next best match
+	char cwd[DIRINDEX_LENGTH_PATH];
+	if (getcwd(cwd, DIRINDEX_LENGTH_PATH) == NULL) cwd[0] = '\0';
+
+	long now = time(NULL);
+	int res = -1;
+	while (1){
+		int best = -1;
+		double bestScore = 0;
+		for (int i=0; i<dirIndex->count; i++){
+			DirEntry* e = &dirIndex->entries[i];
+			if (matchEntry(e, terms, cnt) == 0 || strcmp(e->path, cwd) == 0) continue;
+			double score = frecency(e, now);
+			if (best == -1 || score > bestScore){
+				best = i;
+				bestScore = score;
+			}
+		}
+		if (best == -1) break;
+
+		if (chdir(dirIndex->entries[best].path) == 0){
+			res = 0;
+			break;
+		}
+		//the directory was removed or renamed since it was visited, so it is pruned now and the next one tried
+		if (errno != ENOENT && errno != ENOTDIR) break;
+		removeEntry(best);
+	}
+
+	flock(dirIndexFd, LOCK_UN);
+	return res;
+}
+
+static int compareMatches(const void* a, const void* b){
+	double diff = ((DirMatch*) a)->score - ((DirMatch*) b)->score;
+	return (diff > 0) - (diff < 0);
+}
+
+void dirIndexList(char** terms, int cnt){
+	if (dirIndex == NULL) return;
+	flock(dirIndexFd, LOCK_SH);
+
+	DirMatch* matches = (DirMatch*) malloc(sizeof(DirMatch) * (dirIndex->count + 1));
+	if (matches == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	long now = time(NULL);
+	int matchCnt = 0;
+	for (int i=0; i<dirIndex->count; i++){
+		if (matchEntry(&dirIndex->entries[i], terms, cnt) == 0) continue;
+		matches[matchCnt].score = frecency(&dirIndex->entries[i], now);
+		matches[matchCnt++].entry = &dirIndex->entries[i];
+	}
+
+	qsort(matches, matchCnt, sizeof(DirMatch), compareMatches);
+	for (int i=0; i<matchCnt; i++) printf("%10.1f  %s\n", matches[i].score, matches[i].entry->path);
+	free(matches);
+	flock(dirIndexFd, LOCK_UN);
+}
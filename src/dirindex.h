@@ -0,0 +1,50 @@
+#ifndef DIRINDEX_H
+#define DIRINDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#define DIRINDEX_MAGIC 0x44495231 //"DIR1", lets the shell check it mapped a directory index of this layout
+#define DIRINDEX_FILE ".shell_dirs" //name of the index in the home directory
+#define DIRINDEX_CAPACITY 1024 //directories kept, the lowest ranked one makes room for a new one
+#define DIRINDEX_LENGTH_PATH 240 //longer directories are not recorded
+#define DIRINDEX_AGING 5000 //once the ranks add up to more than this, they are all scaled down by 10%
+
+//a directory visited with cd, ranked by how often it was visited
+typedef struct DirEntry {
+	double rank;		// 1 per visit, aged down over time, the entry is dropped once it falls below 1
+	long last;			// wall clock time of the last visit, in seconds since the epoch
+	char path[DIRINDEX_LENGTH_PATH];
+} DirEntry;
+
+//layout of the index file, which is mapped as is and shared by every shell of the user
+//updates hold an exclusive flock on the file, so that two shells don't change it at the same time
+typedef struct DirIndex {
+	unsigned int magic;
+	int count;			// number of valid entries
+	double totalRank;	// sum of the ranks of the entries
+	DirEntry entries[DIRINDEX_CAPACITY];
+} DirIndex;
+
+//maps the index in the home directory, creating it if needed, returns 0 on success, -1 otherwise
+int initDirIndex(char* home);
+
+//records a visit to dir, which must be an absolute path
+void dirIndexVisit(char* dir);
+
+//changes to the highest scoring directory matching the cnt terms, dropping the ones that no longer exist
+//returns 0 on success, -1 if no directory matched
+int dirIndexJump(char** terms, int cnt);
+
+//prints the directories matching the cnt terms with their scores, the one cd would pick last
+void dirIndexList(char** terms, int cnt);
+
+#endif
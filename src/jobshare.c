@@ -0,0 +1,124 @@
+#include "jobshare.h"
+
+SharedJobTable* jobTable = NULL; //NULL while the job table is not published
+char jobTableName[100];
+
+//writers are the shell and its SIGCHLD handler, so signals are blocked while seq is odd to keep
+//the handler from starting a second write in the middle of the first one
+static sigset_t jobShareBegin(){
+	sigset_t all, old;
+	sigfillset(&all);
+	sigprocmask(SIG_BLOCK, &all, &old);
+
+	__atomic_store_n(&jobTable->seq, jobTable->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE); //seq has to be odd before any entry is changed
+	return old;
+}
+
+static void jobShareEnd(sigset_t old){
+	__atomic_store_n(&jobTable->seq, jobTable->seq + 1, __ATOMIC_RELEASE);
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+void jobShareName(int pid, char* name, int len){
+	snprintf(name, len, "/shell-jobs-%d", pid);
+}
+
+int jobShareStart(){
+	if (jobTable != NULL) return 0;
+
+	jobShareName(getpid(), jobTableName, 100);
+	int fd = shm_open(jobTableName, O_CREAT | O_RDWR | O_TRUNC, 0644);
+	if (fd == -1) return -1;
+	if (ftruncate(fd, sizeof(SharedJobTable)) == -1){
+		close(fd);
+		shm_unlink(jobTableName);
+		return -1;
+	}
+
+	SharedJobTable* table = mmap(NULL, sizeof(SharedJobTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (table == MAP_FAILED){
+		shm_unlink(jobTableName);
+		return -1;
+	}
+
+	//the segment is zero filled by ftruncate, so only the header needs to be set
+	table->shellPID = getpid();
+	table->magic = JOBSHARE_MAGIC;
+	jobTable = table;
+	return 0;
+}
+
+void jobShareStop(){
+	if (jobTable == NULL) return;
+
+	//clear the global first so that a signal handler running in between sees publishing as off
+	SharedJobTable* table = jobTable;
+	jobTable = NULL;
+	munmap(table, sizeof(SharedJobTable));
+	shm_unlink(jobTableName);
+}
+
+int jobShareActive(){
+	return (jobTable != NULL) ? 1 : 0;
+}
+
+void jobShareAdd(int idx, int total, int pid, char status, char separator, long start, char* job){
+	if (jobTable == NULL) return;
+	sigset_t old = jobShareBegin();
+
+	if (idx < JOBSHARE_CAPACITY){
+		SharedJob* entry = &jobTable->jobs[idx];
+		entry->pid = pid;
+		entry->status = status;
+		entry->separator = separator;
+		entry->start = start;
+		strncpy(entry->job, job, JOBSHARE_LENGTH_JOB-1);
+		entry->job[JOBSHARE_LENGTH_JOB-1] = '\0';
+		if (idx >= jobTable->count) jobTable->count = idx+1;
+	}
+	jobTable->total = total;
+
+	jobShareEnd(old);
+}
+
+void jobShareRemove(int idx, int total){
+	if (jobTable == NULL) return;
+	sigset_t old = jobShareBegin();
+
+	if (idx < jobTable->count){
+		memmove(&jobTable->jobs[idx], &jobTable->jobs[idx+1], sizeof(SharedJob) * (jobTable->count - idx - 1));
+		jobTable->count--;
+	}
+	jobTable->total = total;
+
+	jobShareEnd(old);
+}
+
+void jobShareStatus(int idx, char status){
+	if (jobTable == NULL || idx >= jobTable->count) return;
+	sigset_t old = jobShareBegin();
+	jobTable->jobs[idx].status = status;
+	jobShareEnd(old);
+}
+
+void jobShareDone(int pid, int status, long utime, long stime, char* job){
+	if (jobTable == NULL) return;
+	struct timespec tp;
+	clock_gettime(CLOCK_REALTIME, &tp);
+
+	sigset_t old = jobShareBegin();
+
+	SharedDone* entry = &jobTable->done[jobTable->doneCnt % JOBSHARE_RECENT];
+	entry->pid = pid;
+	entry->status = status;
+	entry->end = tp.tv_sec * 1000000L + tp.tv_nsec / 1000;
+	entry->utime = utime;
+	entry->stime = stime;
+	strncpy(entry->job, (job != NULL) ? job : "", JOBSHARE_LENGTH_JOB-1);
+	entry->job[JOBSHARE_LENGTH_JOB-1] = '\0';
+	jobTable->doneCnt++;
+
+	jobShareEnd(old);
+}
@@ -0,0 +1,77 @@
+#ifndef JOBSHARE_H
+#define JOBSHARE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JOBSHARE_MAGIC 0x4a4f4253 //"JOBS", lets readers check they mapped a job table
+#define JOBSHARE_CAPACITY 4096 //jobs published, any jobs past this are only counted in total
+#define JOBSHARE_RECENT 64 //number of finished jobs kept with their resource usage
+#define JOBSHARE_LENGTH_JOB 120
+
+//one entry of the running array, as seen by readers
+typedef struct SharedJob {
+	int pid;
+	char status;		// 'R' running, 'S' stopped or 'D' done, until the shell has used its exit status
+	char separator;		// '&' for background jobs
+	long start;			// wall clock time the job was started, in microseconds since the epoch
+	char job[JOBSHARE_LENGTH_JOB];
+} SharedJob;
+
+//a job that terminated, with the resources it used
+typedef struct SharedDone {
+	int pid;
+	int status;			// exit status, 128+signal if it was killed
+	long end;			// wall clock time it was reaped, in microseconds since the epoch
+	long utime;			// user and system cpu time in microseconds
+	long stime;
+	char job[JOBSHARE_LENGTH_JOB];
+} SharedDone;
+
+//layout of the shared memory segment /shell-jobs-<pid>
+//it is protected by a seqlock: the shell makes seq odd before changing anything and even again after,
+//so a reader retries its copy whenever seq was odd or changed while it was copying
+typedef struct SharedJobTable {
+	unsigned int magic;
+	int shellPID;
+	volatile unsigned int seq;
+	int count;			// number of valid entries in jobs
+	int total;			// number of jobs in the shell, can be larger than count
+	int doneCnt;		// number of finished jobs recorded, done[doneCnt % JOBSHARE_RECENT] is written next
+	SharedDone done[JOBSHARE_RECENT];
+	SharedJob jobs[JOBSHARE_CAPACITY];
+} SharedJobTable;
+
+//writes the name of the shared memory segment of the shell with the given pid into name
+void jobShareName(int pid, char* name, int len);
+
+//creates the shared memory segment, returns 0 on success, -1 otherwise
+int jobShareStart();
+
+//removes the shared memory segment
+void jobShareStop();
+
+//returns 1 if the job table is being published, 0 otherwise
+int jobShareActive();
+
+//publishes the job at index idx of the running array, total is the number of jobs in the array
+void jobShareAdd(int idx, int total, int pid, char status, char separator, long start, char* job);
+
+//removes the job at index idx, moving the jobs after it forward like removeFromPG does
+void jobShareRemove(int idx, int total);
+
+//changes the status of the job at index idx
+void jobShareStatus(int idx, char status);
+
+//records a finished job along with its exit status and cpu time
+void jobShareDone(int pid, int status, long utime, long stime, char* job);
+
+#endif
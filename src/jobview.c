@@ -0,0 +1,108 @@
+#include <stddef.h>
+#include <sched.h>
+#include <errno.h>
+
+#include "jobshare.h"
+
+//jobview - prints the job table a shell publishes with 'jobshare on', without any syscall to the shell or /proc scan
+//usage: jobview <shell pid> [-w <seconds>]
+
+//copies a consistent snapshot of table into copy, returns 0 on success, -1 if the shell kept writing
+int snapshot(SharedJobTable* table, SharedJobTable* copy){
+	for (int attempt=0; attempt<100000; attempt++){
+		unsigned int before = __atomic_load_n(&table->seq, __ATOMIC_ACQUIRE);
+		if (before & 1){ //the shell is in the middle of a change
+			sched_yield();
+			continue;
+		}
+
+		//copy the header and finished jobs, then only the job entries that are in use
+		memcpy(copy, table, offsetof(SharedJobTable, jobs));
+		int count = copy->count;
+		if (count < 0) count = 0;
+		if (count > JOBSHARE_CAPACITY) count = JOBSHARE_CAPACITY;
+		memcpy(copy->jobs, table->jobs, sizeof(SharedJob) * count);
+
+		//the copy is only valid if seq did not move while it was made
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&table->seq, __ATOMIC_RELAXED) == before){
+			copy->count = count;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+void printTable(SharedJobTable* copy){
+	struct timespec tp;
+	clock_gettime(CLOCK_REALTIME, &tp);
+	long now = tp.tv_sec * 1000000L + tp.tv_nsec / 1000;
+
+	printf("Shell %d: %d jobs", copy->shellPID, copy->total);
+	if (copy->total > copy->count) printf(" (%d published)", copy->count);
+	printf("\n");
+
+	if (copy->count > 0) printf("%-4s %-8s %-8s %10s  %s\n", "JOB", "PID", "STATUS", "ELAPSED", "COMMAND");
+	for (int i=0; i<copy->count; i++){
+		SharedJob* job = &copy->jobs[i];
+		printf("[%d]%*s %-8d %-8s %9.1fs  %s%s\n", i+1, (i+1 < 10) ? 1 : 0, "", job->pid,
+			(job->status == 'R') ? "Running" : (job->status == 'S') ? "Stopped" : "Done", (now - job->start) / 1000000.0, job->job,
+			(job->separator == '&') ? "&" : "");
+	}
+
+	//the finished jobs are kept in a ring buffer, print them from the oldest one still in it
+	int first = (copy->doneCnt > JOBSHARE_RECENT) ? copy->doneCnt - JOBSHARE_RECENT : 0;
+	if (copy->doneCnt > 0) {
+		printf("\nRecently finished:\n");
+		printf("%-8s %-6s %9s %9s %9s  %s\n", "PID", "STATUS", "USER", "SYS", "AGO", "COMMAND");
+	}
+	for (int i=first; i<copy->doneCnt; i++){
+		SharedDone* done = &copy->done[i % JOBSHARE_RECENT];
+		printf("%-8d %-6d %8.2fs %8.2fs %8.1fs  %s\n", done->pid, done->status, done->utime / 1000000.0,
+			done->stime / 1000000.0, (now - done->end) / 1000000.0, done->job);
+	}
+}
+
+int main(int argc, char* argv[]){
+	if (argc != 2 && !(argc == 4 && strcmp(argv[2], "-w") == 0)){
+		printf("Usage: jobview <shell pid> [-w <seconds>]\n");
+		exit(1);
+	}
+	double interval = (argc == 4) ? atof(argv[3]) : 0;
+
+	char name[100];
+	jobShareName(atoi(argv[1]), name, 100);
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1){
+		printf("No job table found for shell %s, enable it with 'jobshare on'.\n", argv[1]);
+		exit(1);
+	}
+	SharedJobTable* table = mmap(NULL, sizeof(SharedJobTable), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (table == MAP_FAILED || table->magic != JOBSHARE_MAGIC){
+		printf("%s is not a job table.\n", name);
+		exit(1);
+	}
+
+	SharedJobTable* copy = (SharedJobTable*) malloc(sizeof(SharedJobTable));
+	if (copy == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+
+	while (1){
+		if (snapshot(table, copy) == -1){
+			printf("Could not read a consistent snapshot.\n");
+		} else {
+			printTable(copy);
+		}
+		if (interval <= 0) break;
+
+		//stop watching once the shell is gone, its segment is unlinked but stays mapped here
+		if (kill(table->shellPID, 0) == -1 && errno == ESRCH) break;
+		struct timespec pause = {(long) interval, (long) ((interval - (long) interval) * 1000000000L)};
+		nanosleep(&pause, NULL);
+		printf("\n");
+	}
+
+	free(copy);
+	munmap(table, sizeof(SharedJobTable));
+	return 0;
+}
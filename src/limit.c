@@ -0,0 +1,269 @@
+#include "limit.h"
+
+char cgroupBase[MAX_LENGTH_CGROUP]; //cgroup v2 directory the shell was started in, empty if cgroup v2 is not mounted
+int cgroupReady = 0; //set once the controllers are enabled and job cgroups can be created under cgroupBase
+
+//writes value into a cgroup interface file, returns 0 on success, -1 otherwise
+static int writeCgroupFile(char* dir, char* file, char* value){
+	char path[MAX_LENGTH_CGROUP];
+	snprintf(path, MAX_LENGTH_CGROUP, "%s/%s", dir, file);
+
+	int fd = open(path, O_WRONLY);
+	if (fd == -1) return -1;
+	int res = write(fd, value, strlen(value));
+	close(fd);
+	return (res == (int) strlen(value)) ? 0 : -1;
+}
+
+//reads the first line of a cgroup interface file into buf, returns 0 on success, -1 otherwise
+static int readCgroupFile(char* dir, char* file, char* buf, int len){
+	char path[MAX_LENGTH_CGROUP];
+	snprintf(path, MAX_LENGTH_CGROUP, "%s/%s", dir, file);
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) return -1;
+	int res = read(fd, buf, len-1);
+	close(fd);
+	if (res < 0) return -1;
+	buf[res] = '\0';
+	return 0;
+}
+
+//returns 1 if the space separated controller list contains name as a whole word
+static int hasController(char* list, char* name){
+	char copy[MAX_LENGTH_CGROUP], *save;
+	snprintf(copy, MAX_LENGTH_CGROUP, "%s", list);
+	for (char* tok = strtok_r(copy, " \n", &save); tok != NULL; tok = strtok_r(NULL, " \n", &save)){
+		if (strcmp(tok, name) == 0) return 1;
+	}
+	return 0;
+}
+
+long parseSize(char* arg){
+	char* end;
+	long size = strtol(arg, &end, 10);
+	if (end == arg || size <= 0) return -1;
+
+	if (*end == 'K' || *end == 'k') {size *= 1024L; end++;}
+	else if (*end == 'M' || *end == 'm') {size *= 1024L*1024; end++;}
+	else if (*end == 'G' || *end == 'g') {size *= 1024L*1024*1024; end++;}
+
+	if (*end != '\0') return -1;
+	return size;
+}
+
+void formatSize(double bytes, char* buf, int len){
+	if (bytes >= 1024.0*1024*1024) snprintf(buf, len, "%.1fG", bytes / (1024.0*1024*1024));
+	else if (bytes >= 1024.0*1024) snprintf(buf, len, "%.1fM", bytes / (1024.0*1024));
+	else if (bytes >= 1024.0) snprintf(buf, len, "%.1fK", bytes / 1024.0);
+	else snprintf(buf, len, "%.0fB", bytes);
+}
+
+void initLimits(){
+	char line[MAX_LENGTH_CGROUP], mount[MAX_LENGTH_CGROUP] = "";
+	cgroupBase[0] = '\0';
+
+	//find where the cgroup v2 hierarchy is mounted (/sys/fs/cgroup, or /sys/fs/cgroup/unified on hybrid systems)
+	FILE* fp = fopen("/proc/mounts", "r");
+	if (fp == NULL) return;
+	while (fgets(line, MAX_LENGTH_CGROUP, fp) != NULL){
+		char dir[MAX_LENGTH_CGROUP], type[100];
+		if (sscanf(line, "%*s %999s %99s", dir, type) == 2 && strcmp(type, "cgroup2") == 0){
+			strcpy(mount, dir);
+			break;
+		}
+	}
+	fclose(fp);
+	if (mount[0] == '\0') return;
+
+	//the cgroup v2 entry of the shell is the line starting with 0::
+	fp = fopen("/proc/self/cgroup", "r");
+	if (fp == NULL) return;
+	while (fgets(line, MAX_LENGTH_CGROUP, fp) != NULL){
+		if (strncmp(line, "0::", 3) == 0){
+			line[strcspn(line, "\n")] = '\0';
+			if (strcmp(&line[3], "/") == 0) snprintf(cgroupBase, MAX_LENGTH_CGROUP, "%s", mount);
+			else if (snprintf(cgroupBase, MAX_LENGTH_CGROUP, "%s%s", mount, &line[3]) >= MAX_LENGTH_CGROUP) cgroupBase[0] = '\0';
+			break;
+		}
+	}
+	fclose(fp);
+}
+
+int parseLimits(char* argv[], int argc, Limits* lim){
+	Limits temp = *lim; //only overwrite lim once every argument is valid
+
+	for (int i=1; i<argc; i++){
+		if (strcmp(argv[i], "clear") == 0){
+			temp.cpuPercent = 0;
+			temp.memBytes = 0;
+			temp.maxPids = 0;
+		} else if (strncmp(argv[i], "cpu=", 4) == 0){
+			if ((temp.cpuPercent = atoi(&argv[i][4])) <= 0) return -1;
+		} else if (strncmp(argv[i], "mem=", 4) == 0){
+			if ((temp.memBytes = parseSize(&argv[i][4])) <= 0) return -1;
+		} else if (strncmp(argv[i], "pids=", 5) == 0){
+			if ((temp.maxPids = atoi(&argv[i][5])) <= 0) return -1;
+		} else {
+			return -1;
+		}
+	}
+
+	*lim = temp;
+	return 0;
+}
+
+int hasLimits(Limits* lim){
+	return (lim->cpuPercent > 0 || lim->memBytes > 0 || lim->maxPids > 0) ? 1 : 0;
+}
+
+void printLimits(Limits* lim){
+	if (hasLimits(lim) == 0){
+		printf("No limits set.\n");
+		return;
+	}
+
+	char size[50];
+	if (lim->cpuPercent > 0) printf("cpu=%d%% ", lim->cpuPercent);
+	if (lim->memBytes > 0) {
+		formatSize(lim->memBytes, size, 50);
+		printf("mem=%s ", size);
+	}
+	if (lim->maxPids > 0) printf("pids=%d ", lim->maxPids);
+	printf("(enforced with %s)\n", cgroupReady ? "cgroup v2" : "setrlimit");
+
+	//RLIMIT_NPROC is checked against every process of the user, not only the ones of the job
+	if (lim->maxPids > 0 && cgroupReady == 0){
+		printf("Note: without cgroups, pids counts every process of the user, so a job can't fork at all\n");
+		printf("while the user already runs more than %d processes.\n", lim->maxPids);
+	}
+}
+
+int prepareCgroups(){
+	char buf[MAX_LENGTH_CGROUP], leaf[MAX_LENGTH_CGROUP], pid[20];
+	if (cgroupReady == 1) return 1;
+	if (cgroupBase[0] == '\0') return 0;
+
+	//all three controllers have to be available to the shell's cgroup
+	if (readCgroupFile(cgroupBase, "cgroup.controllers", buf, MAX_LENGTH_CGROUP) == -1
+		|| !hasController(buf, "cpu") || !hasController(buf, "memory") || !hasController(buf, "pids")) return 0;
+
+	//controllers can only be enabled for the children of a cgroup that holds no processes itself,
+	//so the shell first moves into a leaf of its own next to the job leaves
+	if (snprintf(leaf, MAX_LENGTH_CGROUP, "%s/shell-%d", cgroupBase, getpid()) >= MAX_LENGTH_CGROUP) return 0;
+	snprintf(pid, 20, "%d", getpid());
+	if (mkdir(leaf, 0755) == -1 && errno != EEXIST) return 0;
+	if (writeCgroupFile(leaf, "cgroup.procs", pid) == -1){
+		rmdir(leaf);
+		return 0;
+	}
+
+	if (writeCgroupFile(cgroupBase, "cgroup.subtree_control", "+cpu +memory +pids") == -1){
+		//other processes share the cgroup, so move back and rely on setrlimit
+		writeCgroupFile(cgroupBase, "cgroup.procs", pid);
+		rmdir(leaf);
+		return 0;
+	}
+
+	cgroupReady = 1;
+	return 1;
+}
+
+void releaseCgroups(){
+	char leaf[MAX_LENGTH_CGROUP], pid[20];
+	if (cgroupReady == 0) return;
+
+	//the jobs were just killed, so their leaves empty out as the kernel finishes them
+	DIR* dir = opendir(cgroupBase);
+	if (dir != NULL){
+		for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)){
+			if (strncmp(entry->d_name, "job-", 4) != 0) continue;
+			if (snprintf(leaf, MAX_LENGTH_CGROUP, "%s/%s", cgroupBase, entry->d_name) >= MAX_LENGTH_CGROUP) continue;
+			for (int tries=0; tries<50 && rmdir(leaf) == -1 && errno == EBUSY; tries++) usleep(10000);
+		}
+		closedir(dir);
+	}
+
+	//a cgroup with controllers enabled for its children can't hold processes, so they are disabled again first
+	snprintf(pid, 20, "%d", getpid());
+	if (writeCgroupFile(cgroupBase, "cgroup.subtree_control", "-cpu -memory -pids") == -1
+		|| writeCgroupFile(cgroupBase, "cgroup.procs", pid) == -1) return;
+	if (snprintf(leaf, MAX_LENGTH_CGROUP, "%s/shell-%d", cgroupBase, getpid()) < MAX_LENGTH_CGROUP) rmdir(leaf);
+	cgroupReady = 0;
+}
+
+void applyLimits(Limits* lim){
+	if (hasLimits(lim) == 0) return;
+
+	if (cgroupReady == 1){
+		char leaf[MAX_LENGTH_CGROUP], value[50];
+		int failed = 0;
+		if (snprintf(leaf, MAX_LENGTH_CGROUP, "%s/job-%d", cgroupBase, getpid()) >= MAX_LENGTH_CGROUP
+			|| mkdir(leaf, 0755) == -1) failed = 1;
+		if (failed == 0 && lim->cpuPercent > 0){
+			//cpu.max is the quota and period in microseconds, so 100% is one full cpu
+			snprintf(value, 50, "%ld 100000", lim->cpuPercent * 1000L);
+			if (writeCgroupFile(leaf, "cpu.max", value) == -1) failed = 1;
+		}
+		if (failed == 0 && lim->memBytes > 0){
+			snprintf(value, 50, "%ld", lim->memBytes);
+			if (writeCgroupFile(leaf, "memory.max", value) == -1) failed = 1;
+		}
+		if (failed == 0 && lim->maxPids > 0){
+			snprintf(value, 50, "%d", lim->maxPids);
+			if (writeCgroupFile(leaf, "pids.max", value) == -1) failed = 1;
+		}
+		if (failed == 0){
+			snprintf(value, 50, "%d", getpid());
+			if (writeCgroupFile(leaf, "cgroup.procs", value) == 0) return;
+		}
+		rmdir(leaf); //fall through to setrlimit
+	}
+
+	//setrlimit fallback, the limits are inherited by every process the job forks
+	struct rlimit rl;
+	if (lim->memBytes > 0){
+		rl.rlim_cur = rl.rlim_max = lim->memBytes;
+		setrlimit(RLIMIT_AS, &rl);
+	}
+	if (lim->maxPids > 0){
+		//RLIMIT_NPROC counts every process of the user, which is the closest equivalent of pids.max
+		rl.rlim_cur = rl.rlim_max = lim->maxPids;
+		setrlimit(RLIMIT_NPROC, &rl);
+	}
+	if (lim->cpuPercent > 0 && lim->cpuPercent < 100){
+		//there is no rlimit for a share of the cpu, so lower the priority of the job in proportion instead
+		setpriority(PRIO_PROCESS, 0, 19 - (19 * lim->cpuPercent) / 100);
+	}
+}
+
+void printJobUsage(int pid){
+	char leaf[MAX_LENGTH_CGROUP], buf[MAX_LENGTH_CGROUP], size[50];
+	if (cgroupReady == 0) return;
+	if (snprintf(leaf, MAX_LENGTH_CGROUP, "%s/job-%d", cgroupBase, pid) >= MAX_LENGTH_CGROUP) return;
+
+	//jobs started without limits have no cgroup of their own
+	if (readCgroupFile(leaf, "cpu.stat", buf, MAX_LENGTH_CGROUP) == -1) return;
+
+	long usec = 0;
+	char* usage = strstr(buf, "usage_usec ");
+	if (usage != NULL) usec = atol(&usage[strlen("usage_usec ")]);
+	printf("\t(cpu %.2fs", usec / 1000000.0);
+
+	if (readCgroupFile(leaf, "memory.current", buf, MAX_LENGTH_CGROUP) == 0){
+		formatSize(atol(buf), size, 50);
+		printf(", mem %s", size);
+	}
+	if (readCgroupFile(leaf, "pids.current", buf, MAX_LENGTH_CGROUP) == 0){
+		printf(", pids %d", atoi(buf));
+	}
+	printf(")");
+}
+
+void removeJobCgroup(int pid){
+	char leaf[MAX_LENGTH_CGROUP];
+	if (cgroupReady == 0) return;
+
+	//rmdir fails harmlessly if the job had no cgroup, or if processes it forked are still alive in it
+	if (snprintf(leaf, MAX_LENGTH_CGROUP, "%s/job-%d", cgroupBase, pid) < MAX_LENGTH_CGROUP) rmdir(leaf);
+}
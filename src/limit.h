@@ -0,0 +1,60 @@
+#ifndef LIMIT_H
+#define LIMIT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define MAX_LENGTH_CGROUP 1000
+
+typedef struct ResourceLimits {
+	int cpuPercent;		// percentage of one cpu the job may use (cpu.max), 0 if unlimited
+	long memBytes;		// maximum memory of the job in bytes (memory.max), 0 if unlimited
+	int maxPids;		// maximum number of processes in the job (pids.max), 0 if unlimited
+} Limits;
+
+//finds the cgroup v2 directory of the shell, must be called once at startup
+void initLimits();
+
+//parses the 'limit' builtin arguments (cpu=<percent> mem=<size> pids=<n>, or 'clear') into lim
+//returns 0 on success, -1 if an argument is not recognized
+int parseLimits(char* argv[], int argc, Limits* lim);
+
+//converts a size such as 512M or 2G into bytes, returns -1 if it is not valid
+long parseSize(char* arg);
+
+//formats a number of bytes (or bytes per second) into buf using the largest unit that keeps it above 1, i.e. 1.5M
+void formatSize(double bytes, char* buf, int len);
+
+//returns 1 if any limit is set, 0 otherwise
+int hasLimits(Limits* lim);
+
+//prints the limits currently applied to new jobs, and whether cgroups or setrlimit enforce them
+void printLimits(Limits* lim);
+
+//called in the parent when limits are set, moves the shell into its own leaf so job cgroups can be created
+//returns 1 if jobs will be placed in cgroups, 0 if setrlimit will be used instead
+int prepareCgroups();
+
+//called when the shell exits, removes the job leaves left and moves the shell back out of its own leaf
+void releaseCgroups();
+
+//called in the child before exec, places it in a cgroup leaf named after its pid with the limits written to it
+//falls back to setrlimit if the cgroup cannot be created
+void applyLimits(Limits* lim);
+
+//prints the cpu time, memory and number of processes used by a job, read from its cgroup stat files
+void printJobUsage(int pid);
+
+//removes the cgroup leaf of a job once it has terminated
+void removeJobCgroup(int pid);
+
+#endif
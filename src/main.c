@@ -3,12 +3,21 @@
 #include <string.h>
 #include <termios.h>
 #include <math.h>
+#include <time.h>
 
 #include "token.h"
 #include "command.h"
+#include "limit.h"
+#include "trace.h"
+#include "prompt.h"
+#include "jobshare.h"
+#include "schedule.h"
+#include "var.h"
+#include "dirindex.h"
 
 #define MAX_LENGTH_INPUT 100*1000*1000 //100 commands, 1000 arguments, 1000 char for each
 #define MAX_LENGTH_PATH 1000
+#define MAX_JOBS MAX_NUM_TOKENS //size of the running array, a command is refused once it is full
 
 typedef struct sigaction sig;
 
@@ -17,21 +26,31 @@ typedef struct Process {
 	int pid;
 	char* job;
 	char separator;
-	char status;
+	char status; //'R' running, 'S' stopped, or 'D' done, a done job is kept until its exit status is used
+	int exitStatus; //exit code of a done job, 128+signal if it was killed
+	int termSignal; //signal that killed a done job, 0 if it exited
+	long start; //wall clock time the job was started, in microseconds since the epoch
 } Proc;
 
 /*-------GENERAL VARIABLES/FUNCTIONS-------*/
 char* input; //stores initial user input
 char* prompt; //displayed to user as part of shell
-char currentDir[MAX_LENGTH_PATH], homeDir[MAX_LENGTH_PATH], bufUser[MAX_LENGTH_PATH], bufHost[MAX_LENGTH_PATH];
-//stores current directory, home directory, a buffer for username, and a buffer for host name
+char homeDir[MAX_LENGTH_PATH], bufUser[MAX_LENGTH_PATH], bufHost[MAX_LENGTH_PATH];
+//stores home directory, a buffer for username, and a buffer for host name
+//the current directory shown in the prompt is cached by prompt.c and refreshed by cd
 char** tokens; 
 pid_t parentPID; //used to validate pid of process when a signal is caught 
 Command* firstCmd; //pointer to the first command in the linked list of Commands
+int lastStatus = 0; //exit status of the last command, used by the && and || separators
+int lastSignal = 0; //signal that killed the last command waited on, 0 if it exited
+long lastDuration = 0; //time taken by the last line of commands in microseconds, shown by the prompt
+Limits limits = {0, 0, 0}; //resource limits applied to every job started, set with the limit builtin
 
 void processInput(Command** first); //processes each Command in user input based on the starting command
 void freeResources(); //frees all memory that was dynamically allocated during execution
 void printHelp();
+char* lineBuf; //input read from stdin that is not part of a line taken by readInputLine yet
+int lineCnt = 0; //number of characters in lineBuf
 /*-----------------------------------------*/
 
 
@@ -41,13 +60,25 @@ Proc* running; //stores the job information of all process currently running
 
 int pgCnt = 0; //stores the number of PIDs in the array childPG
 int quit = 0; //flag for whether to quit the processInput() method - it's set to true when a SIGINT, SIGQUIT, SIGTSTP signal is received
+int waiting = 0; //set while the wait builtin runs, so that SIGINT ends it
+volatile sig_atomic_t interrupted = 0; //set by SIGINT during the wait builtin
 
 void registerSignalHandler(); //used to register the signal handler to the process at the start
 void catchSignals(int signo); //signal handler method
-void addToPG(int pid, Command* cmd); //adds a child PGID to the childPG array
+int addToPG(int pid, Command* cmd); //adds a child PGID to the childPG array, returns -1 if the array is full
 void removeFromPG(int pid); //removes a child PGID from the childPG array
 void clearPG(); //resets the running array
+void removeDoneJobs(); //drops the background jobs that are done, once the line that was running when they ended is over
 void changeStatus(int childPID, char status); //changes the status of the child if it stopped/resumed/or got killed
+void shareJob(int idx); //publishes running[idx] in the shared memory job table, if it is enabled
+int childState(int pid); //returns 1 if the child is done and takes its status, 0 if it is stopped, -1 if it is still running
+int waitForChild(int pid); //blocks until the child terminates or stops, returns 0 if the user stopped or interrupted it
+void waitForJobs(Command* cmd); //implements the wait builtin
+int parseJobID(char* arg); //converts a job id argument to an int, returns -1 if it is not a number
+void launchTimer(Command* cmd); //starts the command of a timer that came due as a background job
+int isBuiltin(char* name); //returns 1 if name is a command the shell runs itself rather than in a child
+int readInputLine(char* out, int len); //reads the next line of input into out, running timers that come due meanwhile
+int suspendForChild(sigset_t* mask); //sigsuspend that also starts the commands of timers coming due meanwhile
 /*-----------------------------------------*/
 
 int main(){
@@ -64,10 +95,17 @@ int main(){
 	gethostname(bufHost, 1000);
 	
 	//allocate memory for the running jobs array
-	running = (Proc*) malloc(sizeof(Proc) * MAX_NUM_TOKENS);
+	running = (Proc*) malloc(sizeof(Proc) * MAX_JOBS);
 	if (running == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	lineBuf = malloc(sizeof(char) * MAX_LENGTH_INPUT);
+	if (lineBuf == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
 	
 	prompt = NULL;
+	initPrompt(homeDir, bufUser, bufHost);
+	initLimits();
+	initVariables();
+	if (initTimers() == -1) printf("Error creating timer, every and after are unavailable.\n");
+	if (initDirIndex(homeDir) == -1) printf("Error opening the directory index, cd only takes paths.\n");
 	registerSignalHandler();
 
 	while (1){
@@ -79,35 +117,24 @@ int main(){
 		if (input == NULL || tokens == NULL || firstCmd == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
 		
 		initializeCommand(firstCmd);	
-		getcwd(currentDir, MAX_LENGTH_PATH);
+		removeDoneJobs();
 
 		//while loop that prompts user for input until valid input is received
 		while (1){	
-			//if no prompt was specified, print home directory
-			if (prompt == NULL){ 
-				//if the first occurence (if any) of the home directory string is found at the start of the current directory
-				//replace the occurence with ~, just like the terminal
-				if (strstr(currentDir, homeDir) == currentDir) {
-					char temp[MAX_LENGTH_PATH]; 
-					strcpy(temp, currentDir); //set temp to currentDir
-					strcpy(temp, &temp[strlen(homeDir)]); //replace temp with a string that starts AFTER the home directory substring
-
-					strcpy(currentDir, "~"); //set currentDir to ~ and then concatenate temp
-					strcat(currentDir,temp);	
-				}
+			//if no prompt was specified, print user, host and current directory
+			char rendered[MAX_LENGTH_PROMPT];
+			renderPrompt((prompt == NULL) ? DEFAULT_PROMPT : prompt, lastStatus, pgCnt, lastDuration, rendered, MAX_LENGTH_PROMPT);
+			printf("%s ", rendered);
+			fflush(stdout);
 
-				printf("%s@%s:%s$ ", bufUser, bufHost, currentDir);
-			} else {
-				printf("%s ", prompt);
-			}
-	
-			fgets(input, MAX_LENGTH_INPUT, stdin);
+			//sleep until there is input, starting the commands of timers that come due in the meantime
+			int got = readInputLine(input, MAX_LENGTH_INPUT);
 	
 			//checks that input is valid (no interruption occured)
-			if (strlen(input) == 0 && errno == EINTR){
+			if (got == 0){
 				printf("\n");
 				continue;
-			} else if (strlen(input) == 0) {
+			} else if (got == -1) {
 				continue;
 			} else if (input[0] == '\n'){
 				printf("Nothing was entered.\n");
@@ -151,7 +178,14 @@ int main(){
 			if (noCommands == -1) {
 				perror("Error separating commands from input.\n");
 			} else {	
+				struct timespec begin, end;
+				clock_gettime(CLOCK_MONOTONIC, &begin);
 				processInput(&firstCmd);
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				lastDuration = (end.tv_sec - begin.tv_sec) * 1000000L + (end.tv_nsec - begin.tv_nsec) / 1000;
+
+				//any command may have switched branches, the lookup runs in the background so the prompt doesn't wait
+				updatePromptBranch();
 			}
 			
 			//memory was dynamically allocated to store global pointers
@@ -167,31 +201,94 @@ void processInput(Command** first){
 	Command** current = first;
 	quit = 0;
 	int fdPipe[2];
+	char prevSeparator = ';'; //separator of the previously processed command
+	sigset_t blockChild, oldMask; //used to hold SIGCHLD back while a new child is registered in the running array
+	sigemptyset(&blockChild);
+	sigaddset(&blockChild, SIGCHLD);
 	
 	//run through each Command and process them
 	while (*current){
+		//short circuit evaluation for && and ||, based on the exit status of the previous command
+		//the skipped command (along with the rest of its pipeline) leaves lastStatus untouched
+		//so that 'a && b || c' runs c when a fails
+		if ((prevSeparator == SEP_AND && lastStatus != 0) || (prevSeparator == SEP_OR && lastStatus == 0)){
+			while ((*current)->nextCmd != NULL && (*current)->separator == '|'){
+				current = &((*current)->nextCmd);
+			}
+			prevSeparator = (*current)->separator;
+			current = &((*current)->nextCmd);
+			continue;
+		}
+		prevSeparator = (*current)->separator;
+
+		//variables are expanded as each command is reached rather than when the line is read,
+		//so that 'A=1 ; echo $A' sees the assignment, a pipeline is expanded as a whole before it forks
+		for (Command* c = *current; c != NULL; c = c->nextCmd){
+			if (c->expand == 1) expandArguments(c, lastStatus);
+			if (c->separator != '|') break;
+		}
+
+		//'limit <opts> -- cmd' runs cmd with limits of its own, so the prefix is taken off before cmd is dispatched
+		//an invalid prefix is left in place, for the limit builtin to report
+		Limits cmdLimits = limits;
+		Limits* jobLimits = &limits;
+		if (strcmp((*current)->path, "limit") == 0){
+			int dash = 1;
+			while (dash < (*current)->argc && strcmp((*current)->argv[dash], "--") != 0) dash++;
+			if (dash+1 < (*current)->argc && parseLimits((*current)->argv, dash, &cmdLimits) == 0){
+				dropArguments(*current, dash+1);
+				jobLimits = &cmdLimits;
+				if (hasLimits(jobLimits) == 1) prepareCgroups();
+			}
+		}
+
 		//IF ELSE block that checks for each of the four built in commands that must run on the main process
 		if (strcmp((*current)->path, "helpme") == 0) {
 			printHelp();
+			lastStatus = 0;
 		} else if (strcmp((*current)->path, "exit") == 0) {
+			jobShareStop();
 			//kills all running processes
-			if (waitpid(-1, NULL, WNOHANG) == 0) {
+			int live = 0;
+			for (int i=0; i<pgCnt; i++){
+				if (running[i].status != 'D') live = 1;
+			}
+			if (live == 1) {
+				//the handler would otherwise run for every job killed here, only to print it as done
+				sigprocmask(SIG_BLOCK, &blockChild, NULL);
 				printf("\nThese child processes were killed while terminating the shell:\n");
 				for (int i=0; i<pgCnt; i++){
+					if (running[i].status == 'D') continue;
 					printf("[%d] %d - %s\n", i+1, running[i].pid, running[i].job);
 					kill(-1 * running[i].pid, SIGKILL);
 				}				
-				clearPG();
 			} 
+			releaseCgroups(); //the shell leaves its cgroup leaf once the jobs in theirs are gone
+			clearPG();
 			exit(0);
 		} else if (strcmp((*current)->path, "cd") == 0){
 			//replace home directory string with tilde if possible
 			//change directory to path argument
-			if ((*current)->argc == 1 || strcmp((*current)->argv[1], "~") == 0){
-				chdir(homeDir);
+			lastStatus = 0;
+			if ((*current)->argc >= 2 && strcmp((*current)->argv[1], "-l") == 0){
+				dirIndexList(&(*current)->argv[2], (*current)->argc - 2);
 			} else {
-				if (chdir((*current)->argv[1]) == -1) printf("Path not recognized.\n");
-			}	
+				if ((*current)->argc == 1 || strcmp((*current)->argv[1], "~") == 0){
+					if (chdir(homeDir) == -1) lastStatus = 1;
+				} else if (chdir((*current)->argv[1]) == -1){
+					//not a path, so the arguments are looked up as parts of a directory visited before
+					if (dirIndexJump(&(*current)->argv[1], (*current)->argc - 1) == -1){
+						printf("Path not recognized.\n");
+						lastStatus = 1;
+					}
+				}
+
+				//every directory cd lands in is recorded, so that it can be jumped to later
+				char cwd[DIRINDEX_LENGTH_PATH];
+				if (lastStatus == 0 && getcwd(cwd, DIRINDEX_LENGTH_PATH) != NULL) dirIndexVisit(cwd);
+			}
+			//the prompt caches the current directory, so it is only refreshed here
+			updatePromptDir();
 		} else if (strcmp((*current)->path, "prompt") == 0){
 			//free previous value of prompt
 			free(prompt);			
@@ -200,108 +297,317 @@ void processInput(Command** first){
 				prompt = NULL;
 			} else {
 				printf("(Prompt changed. Reset by entering 'prompt' with no arguments.)\n");
-				prompt = strdup((*current)->argv[1]);
-				//assign a new pointer to prompt, a duplicate of the current argv value
+				//join the arguments back together with spaces, so the format can contain spaces
+				int length = 0;
+				for (int i=1; i<(*current)->argc; i++) length += strlen((*current)->argv[i]) + 1;
+				prompt = (char*) malloc(sizeof(char) * length);
+				if (prompt == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+				prompt[0] = '\0';
+				for (int i=1; i<(*current)->argc; i++){
+					if (i > 1) strcat(prompt, " ");
+					strcat(prompt, (*current)->argv[i]);
+				}
 			}
+			lastStatus = 0;
 		} else if (strcmp((*current)->path, "pwd") == 0){
 			//get current working directory with getcwd, and then print it
 			char dirPrint[MAX_LENGTH_PATH];
 			if (getcwd(dirPrint, MAX_LENGTH_PATH) == NULL){
 				printf("Error printing current working directory.\n");
+				lastStatus = 1;
 			} else {
 				printf("%s\n", dirPrint);
+				lastStatus = 0;
 			}			
 		} else if (strcmp((*current)->path, "jobs") == 0) { ///--- new	
-			//print out values stored in running array
-			if (pgCnt == 0) {
+			//'jobs -l' also prints the resource usage of jobs that run in their own cgroup
+			int longFormat = ((*current)->argc > 1 && strcmp((*current)->argv[1], "-l") == 0) ? 1 : 0;
+
+			//print out values stored in running array, followed by the timers waiting to start their command
+			if (pgCnt == 0 && timerCount() == 0) {
 				printf("No jobs exist.\n");
 			} else {			
 				for (int m = 0; m < pgCnt ; m++){
 					if (running[m].status == 'R') {
-						printf("[%d]   Running\t\t%d - %s\n", m+1, running[m].pid, running[m].job);
+						printf("[%d]   Running\t\t%d - %s", m+1, running[m].pid, running[m].job);
+					} else if (running[m].status == 'S') {
+						printf("[%d]   Stopped\t\t%d - %s", m+1, running[m].pid, running[m].job);
 					} else {
-						printf("[%d]   Stopped\t\t%d - %s\n", m+1, running[m].pid, running[m].job);
+						printf("[%d]   Done (%d)\t\t%d - %s", m+1, running[m].exitStatus, running[m].pid, running[m].job);
 					}
+					if (longFormat == 1) printJobUsage(running[m].pid);
+					printf("\n");
 				}
+				printTimers();
+			}
+			lastStatus = 0;
+		} else if (strcmp((*current)->path, "every") == 0 || strcmp((*current)->path, "after") == 0){
+			//every <interval> cmd... runs cmd periodically, after <delay> cmd... runs it once
+			long interval = ((*current)->argc > 2) ? parseInterval((*current)->argv[1]) : -1;
+			if (interval == -1){
+				printf("Usage: %s <interval> <command> [args], where interval is like 5, 1.5s, 500ms, 2m or 1h\n", (*current)->path);
+				lastStatus = 1;
+			} else {
+				int periodic = (strcmp((*current)->path, "every") == 0) ? 1 : 0;
+				int id = (isBuiltin((*current)->argv[2]) == 1) ? -2 : addTimer(interval, (periodic == 1) ? interval : 0, *current, 2);
+				if (id == -2){
+					printf("%s only runs programs, '%s' is a builtin.\n", (*current)->path, (*current)->argv[2]);
+					lastStatus = 1;
+				} else if (id == -1){
+					printf("Timers are unavailable.\n");
+					lastStatus = 1;
+				} else {
+					printf("[t%d] scheduled\n", id);
+					lastStatus = 0;
+				}
+			}
+		} else if (strcmp((*current)->path, "cancel") == 0){
+			//timer ids are shown as t<d> by jobs, so accept them with or without the t
+			char* arg = ((*current)->argc == 2) ? (*current)->argv[1] : "";
+			int id = parseJobID((arg[0] == 't') ? arg+1 : arg);
+			if (id <= 0 || cancelTimer(id) == -1){
+				printf("Invalid timer id specified. Usage: cancel <t>\n");
+				lastStatus = 1;
+			} else {
+				lastStatus = 0;
+			}
+		} else if (strcmp((*current)->path, "wait") == 0){
+			waitForJobs(*current);
+		} else if (strcmp((*current)->path, "limit") == 0){
+			lastStatus = 0;
+			if ((*current)->argc > 1 && parseLimits((*current)->argv, (*current)->argc, &limits) == -1){
+				printf("Invalid limit. Usage: limit [cpu=<percent>] [mem=<size>] [pids=<n>] [-- <command>], or limit clear\n");
+				lastStatus = 1;
+			} else {
+				//try to set up cgroups the first time limits are needed, setrlimit is used otherwise
+				if (hasLimits(&limits) == 1) prepareCgroups();
+				printLimits(&limits);
+			}
+		} else if (strcmp((*current)->path, "pipesize") == 0){
+			lastStatus = 0;
+			if ((*current)->argc == 1){
+				if (pipeSize == 0) printf("Pipes use the default capacity.\n");
+				else printf("Pipes are created with a capacity of %d bytes.\n", pipeSize);
+			} else if (strcmp((*current)->argv[1], "default") == 0){
+				pipeSize = 0;
+			} else {
+				long size = parseSize((*current)->argv[1]);
+				if (size <= 0 || size > 1024*1024*1024){
+					printf("Invalid pipe size.\n");
+					lastStatus = 1;
+				} else {
+					pipeSize = (int) size;
+				}
+			}
+		} else if (strcmp((*current)->path, "pipemeter") == 0){
+			lastStatus = 0;
+			if ((*current)->argc == 2 && strcmp((*current)->argv[1], "on") == 0){
+				pipeMeter = 1;
+			} else if ((*current)->argc == 2 && strcmp((*current)->argv[1], "off") == 0){
+				pipeMeter = 0;
+			} else {
+				printf("Usage: pipemeter on, or pipemeter off\n");
+				lastStatus = 1;
+			}
+		} else if (isAssignment((*current)->path) == 1){
+			//NAME=value sets a shell variable, which only reaches the environment of jobs once exported
+			//every argument is checked first, so that 'NAME=x ls' is refused as a whole instead of setting NAME
+			lastStatus = 0;
+			for (int i=0; i<(*current)->argc; i++){
+				if (isAssignment((*current)->argv[i]) == 0){
+					printf("Invalid assignment '%s', use export to pass variables to a command.\n", (*current)->argv[i]);
+					lastStatus = 1;
+					break;
+				}
+			}
+			for (int i=0; i<(*current)->argc && lastStatus == 0; i++){
+				char* arg = (*current)->argv[i];
+				char* equals = strchr(arg, '=');
+				*equals = '\0';
+				setVariable(arg, equals+1);
+				*equals = '=';
+			}
+		} else if (strcmp((*current)->path, "export") == 0){
+			lastStatus = 0;
+			if ((*current)->argc == 1) printExported();
+			for (int i=1; i<(*current)->argc; i++){
+				char* arg = (*current)->argv[i];
+				char* equals = strchr(arg, '=');
+				if (equals != NULL && isAssignment(arg) == 1){
+					*equals = '\0';
+					setVariable(arg, equals+1);
+					exportVariable(arg);
+					*equals = '=';
+				} else if (equals == NULL && isVariableName(arg, strlen(arg)) == 1){
+					exportVariable(arg);
+				} else {
+					printf("Invalid variable name '%s'.\n", arg);
+					lastStatus = 1;
+				}
+			}
+		} else if (strcmp((*current)->path, "unset") == 0){
+			lastStatus = 0;
+			for (int i=1; i<(*current)->argc; i++){
+				if (isVariableName((*current)->argv[i], strlen((*current)->argv[i])) == 0){
+					printf("Invalid variable name '%s'.\n", (*current)->argv[i]);
+					lastStatus = 1;
+				} else {
+					unsetVariable((*current)->argv[i]); //unsetting a variable that is not set is not an error
+				}
+			}
+		} else if (strcmp((*current)->path, "argbatch") == 0){
+			lastStatus = 0;
+			if ((*current)->argc == 1){
+				if (argBatch == 0) printf("Argument lists longer than ARG_MAX (%ld bytes left) are not split.\n", argumentLimit());
+				else printf("Argument lists longer than ARG_MAX (%ld bytes left) are split, %d batches run at once.\n", argumentLimit(), argBatch);
+			} else if (strcmp((*current)->argv[1], "off") == 0){
+				argBatch = 0;
+			} else if (strcmp((*current)->argv[1], "on") == 0){
+				argBatch = 1;
+			} else if (parseJobID((*current)->argv[1]) > 0){
+				argBatch = parseJobID((*current)->argv[1]);
+			} else {
+				printf("Usage: argbatch on, argbatch <n> to run n batches at once, or argbatch off\n");
+				lastStatus = 1;
+			}
+		} else if (strcmp((*current)->path, "jobshare") == 0){
+			lastStatus = 0;
+			if ((*current)->argc == 2 && strcmp((*current)->argv[1], "on") == 0){
+				if (jobShareStart() == -1){
+					printf("Error creating shared memory job table.\n");
+					lastStatus = 1;
+				} else {
+					//publish the jobs that already exist, later changes are published as they happen
+					for (int i=0; i<pgCnt; i++) shareJob(i);
+					char name[100];
+					jobShareName(getpid(), name, 100);
+					printf("Job table published in shared memory as %s.\n", name);
+				}
+			} else if ((*current)->argc == 2 && strcmp((*current)->argv[1], "off") == 0){
+				jobShareStop();
+			} else {
+				printf("Usage: jobshare on, or jobshare off\n");
+				lastStatus = 1;
+			}
+		} else if (strcmp((*current)->path, "trace") == 0){
+			lastStatus = 0;
+			if ((*current)->argc == 2 && strcmp((*current)->argv[1], "on") == 0){
+				if (traceStart() == -1) {
+					printf("Error allocating trace buffer.\n");
+					lastStatus = 1;
+				}
+			} else if ((*current)->argc == 2 && strcmp((*current)->argv[1], "off") == 0){
+				traceStop();
+			} else if ((*current)->argc == 3 && strcmp((*current)->argv[1], "save") == 0){
+				int saved = traceSave((*current)->argv[2]);
+				if (saved == -2) {
+					printf("Tracing is off, start recording with 'trace on' first.\n");
+					lastStatus = 1;
+				} else if (saved == -1) {
+					printf("Error opening file.\n");
+					lastStatus = 1;
+				} else {
+					printf("%d events written to %s.\n", saved, (*current)->argv[2]);
+				}
+			} else {
+				printf("Usage: trace on, trace off, or trace save <file>\n");
+				lastStatus = 1;
 			}
 		} else if (strcmp((*current)->path, "fg") == 0){ ///--- new
 			if ((*current)->argc  == 1){ 
 				printf("No job id specified.\n");
+				lastStatus = 1;
 			} else {
 			//check that its valid int
-			int jobID = 0;
-
-			//loops through each character in the first argument from the back to the front
-			//first, the character is converted to an int
-			//then it uses pow from the math library to exponentiate the value based on its place
-			//then adds that value to the final int jobID variable
-			for (int i=strlen((*current)->argv[1])-1; i>=0; i--){
-				int charToInt = (int) ((*current)->argv[1][i] - '0');
-				jobID += charToInt * (int) pow(10, strlen((*current)->argv[1])-1-i);
-			}
+			int jobID = parseJobID((*current)->argv[1]);
 				if (jobID <= 0 || jobID > pgCnt){
 					printf("Invalid job id specified.\n");
+					lastStatus = 1;
 				} else {
-					int status = 0; 
-
 					//extract the child process number
 					int childProcess =  running[jobID-1].pid;
 					printf("%s\n", running[jobID-1].job);
-					kill(childProcess, SIGCONT); //send a continue signal to process
-					//if it's already running, it will be ignored
-
-					//WNOHANG with wait to just check if it continued
-					waitpid(childProcess, &status, WCONTINUED | WNOHANG);
-					//here status is checkd to see if it continued
-					if (WIFCONTINUED(status)){
-						//if continued, then reap that status and wait for it
-						//to chagne state i.e. continue
-						waitid(P_PID, childProcess, NULL, WCONTINUED);
+
+					if (running[jobID-1].status == 'D'){
+						//the job is done already and only hands over its status, its pid may belong to another process by now
+						waitForChild(childProcess);
+					} else {
+						//mark the job as running before it is continued, so that waiting on it
+						//does not mistake its previous stopped state for a new stop
+						changeStatus(childProcess, 'C');
+						kill(childProcess, SIGCONT); //send a continue signal to process
+						//if it's already running, it will be ignored
+						
+						//set child as foreground process
+						tcsetpgrp(STDIN_FILENO, childProcess);
+						tcsetpgrp(STDOUT_FILENO, childProcess);	
+						foreground = childProcess;
+
+						//wait for child to terminate
+						if (waitForChild(childProcess) == 0) quit = 1;
+
+						//set parent back as foreground process (main shell)
+						tcsetpgrp(STDIN_FILENO, parentPID);
+						tcsetpgrp(STDOUT_FILENO, parentPID);
+						foreground = 0;
 					}
-					
-					//set child as foreground process
-					status=0;//reset status information
-					tcsetpgrp(STDIN_FILENO, childProcess);
-					tcsetpgrp(STDOUT_FILENO, childProcess);	
-					foreground = childProcess;
-
-					//wait for child to terminate
-					while (waitpid(childProcess, &status, 0) > 0) {}
-
-					if (WIFEXITED(status) == 0) quit = 1;
-
-					//set parent back as foreground process (main shell)
-					tcsetpgrp(STDIN_FILENO, parentPID);
-					tcsetpgrp(STDOUT_FILENO, parentPID);
-					foreground = 0;
 				}
 			}
+		} else if (pgCnt >= MAX_JOBS){
+			//the job table is full, so the command (along with the rest of its pipeline) is not started
+			printf("Too many jobs, '%s' was not started. Wait for some of them to finish.\n", (*current)->path);
+			lastStatus = 1;
+			while ((*current)->nextCmd != NULL && (*current)->separator == '|') current = &((*current)->nextCmd);
+			prevSeparator = (*current)->separator;
 		} else {
+			//count the commands of a pipeline, and create the meters its relays write to before forking
+			int stages = 1;
+			if ((*current)->separator == '|'){
+				for (Command* c = *current; c->nextCmd != NULL && c->separator == '|'; c = c->nextCmd) stages++;
+				meterStage = 0;
+				if (pipeMeter == 1) meters = createMeters(stages);
+			}
+
 			//fork to process other commands in the child
 			pipe(fdPipe);	
+			//SIGCHLD is held back until the child is in the running array, so the handler always reaps it
+			sigprocmask(SIG_BLOCK, &blockChild, &oldMask);
 			pid_t pid = fork();
 
 			//permit effective job control by setting the child process to be in its own process group
 			//to avoid race conditions, both parent and child will set the pgid of the child to be pid of child
 			if (pid == 0){
+				sigprocmask(SIG_SETMASK, &oldMask, NULL); //the signal mask is inherited across exec
 				setpgid(0, getpid());
 				//set the pgid for all child processes for this string of commands to the pid of the first child
+
+				//limits are applied before exec, so every process of the job (including a pipeline) inherits them
+				applyLimits(jobLimits);
 			} else {
 				setpgid(pid, pid);
-				addToPG(pid, *current); 
-				if ((*current)->separator == '&') printf("[%d] %d - %s\n", pgCnt, pid, running[pgCnt-1].job);
+				traceEvent(TRACE_FORK, pid, pid, (*current)->path);
+				if (addToPG(pid, *current) == 0 && (*current)->separator == '&') printf("[%d] %d - %s\n", pgCnt, pid, running[pgCnt-1].job);
+				sigprocmask(SIG_SETMASK, &oldMask, NULL);
 				//parent	
 				//pid here refers to the value returned by the fork which is the child pid
 			}
 
 			switch ((*current)->separator){
 				case '&':
+					//the pipe is only used to wait for sequential commands, close it so that jobs don't leak descriptors
+					close(fdPipe[0]);
+					close(fdPipe[1]);
 					if (pid==0){ //child, execute
 						executeCommand(*current);
 					} else if (pid<0) { //error
 						printf("Error executing command.\n");
+						lastStatus = 1;
+					} else {
+						lastStatus = 0;
 					}
 					break;
+				case SEP_AND:
+				case SEP_OR:
 				case ';':
 					//similarly, to avoid race conditions, both parent and child will set the child as the foreground process
 					//for sequential execution
@@ -314,16 +620,12 @@ void processInput(Command** first){
 						tcsetpgrp(STDOUT_FILENO, pid);	
 						foreground = pid;
 		
-						int status;
 						//wait till pid child dies and no longer exists
-						while (waitpid(pid, &status, 0) > 0){					
-						}
-
-						//if a foreground process was terminated 
+						//if a foreground process was interrupted by the user
 						//then set quit flag to 1 so that the rest of the commands are ignored
-						//WIFEXITED is used to check if the process terminated normally or using a user signal
-						//such as CTRL C \ etc
-						if (WIFEXITED(status) == 0) quit = 1;
+						//waitForChild returns 0 only if the process was stopped or killed using a signal from the keyboard (SIGINT or SIGQUIT)
+						//a crash or any other signal leaves 128+signal in lastStatus, which && and || decide on
+						if (waitForChild(pid) == 0) quit = 1;
 
 						//once child process has ended, set main shell process as foreground process again
 						tcsetpgrp(STDIN_FILENO, parentPID);
@@ -337,6 +639,7 @@ void processInput(Command** first){
 						while (read(fdPipe[0], buf, 1) > 0){
 							//do nothing until child exits (closing all fds and stdout)
 						}
+						close(fdPipe[0]);
 
 					} else if (pid==0){ //child execute
 						//set child as foreground process
@@ -350,9 +653,12 @@ void processInput(Command** first){
 						executeCommand(*current);
 					} else {
 						printf("Error executing command.\n");
+						lastStatus = 1;
 					}	
 					break;
 				case '|':
+					close(fdPipe[0]);
+					close(fdPipe[1]);
 					if (pid==0){
 						tcsetpgrp(STDIN_FILENO, getpid());
 						tcsetpgrp(STDOUT_FILENO, getpid());
@@ -365,14 +671,15 @@ void processInput(Command** first){
 						tcsetpgrp(STDOUT_FILENO, pid);	
 						foreground = pid;
 		
-						int status;
-						waitpid(pid, &status, 0);
-
-						//if a foreground process was terminated 
+						//the exit status of the pipeline is the one of its last command, which pid execs
+						//if a foreground process was interrupted by the user
 						//then set quit flag to 1 so that the rest of the commands are ignored
-						//WIFEXITED is used to check if the process terminated normally or using a user signal
-						//such as CTRL C \ etc
-						if (WIFEXITED(status) == 0) quit = 1;
+						if (waitForChild(pid) == 0) quit = 1;
+
+						if (meters != NULL){
+							reportMeters(meters, stages);
+							meters = NULL;
+						}
 
 						//once child process has ended, set main shell process as foreground process again
 						tcsetpgrp(STDIN_FILENO, parentPID);
@@ -385,6 +692,7 @@ void processInput(Command** first){
 						//short circuit evaluation checks that the next cmd isn't NULL first before trying to access the separator
 							current = &((*current)->nextCmd);
 						}
+						prevSeparator = (*current)->separator;
 					}
 			}
 		}
@@ -420,6 +728,8 @@ void freeResources(){
 			free((*del)->argv[i]); //free each individual argument
 		}
 		free((*del)->argv); //free the block of arguments
+		free((*del)->stdin_file); //the redirection file names are copies owned by the command
+		free((*del)->stdout_file);
 		free(*del); //free the command itself
 		*del = NULL;
 	}
@@ -464,16 +774,12 @@ void registerSignalHandler(){
 void catchSignals(int signo){
 	//process the three user interruption signals from terminal keyboard
 	if (signo == SIGINT || signo == SIGQUIT || signo == SIGTSTP){
-		if (getpid() == parentPID){ //parent waits for child to terminate
-			if (foreground == 0){
-				//waitpid WNOHANG returns -1 if no children exist 
-				if (waitpid(-1, NULL, WNOHANG) <= 0) {
-					printf("\nUse 'exit' to close the shell instead.");			
-				} else {
-					//wait returns -1 only if there are no more children to wait for
-					while (waitpid(-1, NULL, WNOHANG) > 0){	
-					}
-				} //parent waits for all children to finish
+		if (getpid() == parentPID){
+			//children are only ever reaped below, so that their exit status reaches the running array
+			if (foreground == 0 && signo == SIGINT && waiting == 1){
+				interrupted = 1; //ends the wait builtin, like in bash
+			} else if (foreground == 0){
+				printf("\nUse 'exit' to close the shell instead.");			
 			}
 		} else {
 			//child will terminate itself
@@ -481,41 +787,66 @@ void catchSignals(int signo){
 		}
 	//claim zombies here, or change status of current processes
 	} else if (signo == SIGCHLD){
-		//for each currently running process that is known (using the running array)
-		//use waitid to see if they have changed state
-		for (int i=0; i<pgCnt; i++){
-			siginfo_t status;
-			status.si_pid = 0;
-			//waitid stores additional status information in 'status'
-			
-			//get status information, and if si_pid = 0, it means that there is no process with a waitable state, 
-			//so break the for loop and stop searching
-			//else compare the si_code to see how it ended
-			while (waitid(P_ALL, 0, &status, WEXITED | WCONTINUED | WSTOPPED | WNOHANG) >= 0){
-					if (status.si_pid == 0) {
-						break;
-						//test if child was resumed or stopped
-					} else if (status.si_code == CLD_CONTINUED){
-						changeStatus(status.si_pid, 'C');
-					} else if (status.si_code == CLD_STOPPED){
-						//print that the process was stopped
-						for (int i=0; i<pgCnt; i++){
-							if (running[i].pid == status.si_pid){
-								printf("\n[%d]+ Stopped\t\t%d - %s\n", i+1, running[i].pid, running[i].job);
-							}
+		//the resource usage of a reaped child is the growth of RUSAGE_CHILDREN across its waitid
+		struct rusage before, after;
+		int share = jobShareActive();
+		if (share == 1) getrusage(RUSAGE_CHILDREN, &before);
+
+		//use waitid to see which children have changed state, one pass drains every child that is waitable
+		siginfo_t status;
+		status.si_pid = 0;
+		//waitid stores additional status information in 'status'
+		
+		//get status information, and if si_pid = 0, it means that there is no process with a waitable state, 
+		//so stop searching
+		//else compare the si_code to see how it ended
+		while (waitid(P_ALL, 0, &status, WEXITED | WCONTINUED | WSTOPPED | WNOHANG) >= 0){
+				if (status.si_pid == 0) {
+					break;
+					//test if child was resumed or stopped
+				} else if (status.si_code == CLD_CONTINUED){
+					traceEvent(TRACE_CONT, status.si_pid, status.si_pid, NULL);
+					changeStatus(status.si_pid, 'C');
+				} else if (status.si_code == CLD_STOPPED){
+					//print that the process was stopped
+					for (int i=0; i<pgCnt; i++){
+						if (running[i].pid == status.si_pid){
+							printf("\n[%d]+ Stopped\t\t%d - %s\n", i+1, running[i].pid, running[i].job);
 						}
-						changeStatus(status.si_pid, 'S');
-					} else if (status.si_code == CLD_EXITED || status.si_code == CLD_KILLED){
-						//check if ended process was a background one, if so, print the job id and indicate that it ended
+					}
+					traceEvent(TRACE_STOP, status.si_pid, status.si_pid, NULL);
+					changeStatus(status.si_pid, 'S');
+				} else if (status.si_code == CLD_EXITED || status.si_code == CLD_KILLED || status.si_code == CLD_DUMPED){
+					//killed by a signal gives 128+signal, same convention as bash
+					int code = (status.si_code == CLD_EXITED) ? status.si_status : 128 + status.si_status;
+					int sig = (status.si_code == CLD_EXITED) ? 0 : status.si_status;
+					traceEvent(TRACE_REAP, status.si_pid, status.si_pid, NULL);
+
+					if (share == 1){
+						getrusage(RUSAGE_CHILDREN, &after);
+						long utime = (after.ru_utime.tv_sec - before.ru_utime.tv_sec) * 1000000L + (after.ru_utime.tv_usec - before.ru_utime.tv_usec);
+						long stime = (after.ru_stime.tv_sec - before.ru_stime.tv_sec) * 1000000L + (after.ru_stime.tv_usec - before.ru_stime.tv_usec);
+						char* job = NULL;
 						for (int i=0; i<pgCnt; i++){
-							if (running[i].pid == status.si_pid){
-								if (running[i].separator == '&') printf("\n[%d]- Done\t\t%d - %s", i+1, running[i].pid, running[i].job);
-							} 
+							if (running[i].pid == status.si_pid) job = running[i].job;
 						}
+						jobShareDone(status.si_pid, code, utime, stime, job);
+						before = after;
 					}
-			}
-			
-		}	
+
+					//the job keeps its exit status until a wait takes it, or until the line ends for a background job
+					//check if ended process was a background one, if so, print the job id and indicate that it ended
+					for (int i=0; i<pgCnt; i++){
+						if (running[i].pid == status.si_pid && running[i].status != 'D'){
+							running[i].status = 'D';
+							running[i].exitStatus = code;
+							running[i].termSignal = sig;
+							jobShareStatus(i, 'D');
+							if (running[i].separator == '&') printf("\n[%d]- Done\t\t%d - %s", i+1, running[i].pid, running[i].job);
+						} 
+					}
+				}
+		}
 	} else if (signo == SIGTERM){
 		if (parentPID == getpid()) {
 			printf("Shell process cannot be terminated with 'kill'. Use 'exit' instead.\n");
@@ -523,22 +854,23 @@ void catchSignals(int signo){
 			exit(0);
 		}
 	}
-	
-	//clear process group array by sending a signal 0 with kill
-	//kill with 0 sends no signal but performs error checking anyway
-	for (int i=pgCnt-1; i>=0; i--){ //iterate from the back as elements are pushed forward once removed
-		if (kill(running[i].pid, 0) != 0){
-			//process doesn't exist anymore
-			removeFromPG(running[i].pid);
-		}
-	}
 }
 
-void addToPG(int pid, Command* cmd){
+int addToPG(int pid, Command* cmd){
 	//if a match for the process group is already found in array, then ignore and return back
 	//this happens when both parent and child tries to add it
+	//a done job with the same pid is an older job whose pid was recycled, so it gives way to the new one
 	for (int i=0; i<pgCnt; i++){
-		if (running[i].pid == pid) return;
+		if (running[i].pid == pid && running[i].status == 'D'){
+			removeFromPG(pid);
+			break;
+		}
+		if (running[i].pid == pid) return 0;
+	}
+	//callers check for room before they fork, this only keeps a full array from being written past
+	if (pgCnt >= MAX_JOBS){
+		printf("Too many jobs, %d is not tracked.\n", pid);
+		return -1;
 	}
 	
 	//add the values of the pid and command to the running array element
@@ -547,13 +879,11 @@ void addToPG(int pid, Command* cmd){
 	int loop = 0, lengthCmd = 0;
 	
 	//reset all values of job
-	free(running[pgCnt].job);	
-	running[pgCnt].job = NULL;
-	running[pgCnt].job = (char*) malloc(sizeof(char) * MAX_NUM_TOKENS);
-	//fill with null-terminating characters to write over previous values if any
-	for (int j = 0; j< MAX_NUM_TOKENS; j++){
-		running[pgCnt].job[j] = '\0';
-	}
+	//the job string is allocated to the length of the command, so that thousands of jobs stay cheap
+	for (int j = 0; cmd->argv[j] != NULL; j++) lengthCmd += strlen(cmd->argv[j]) + 1;
+	running[pgCnt].job = (char*) calloc(lengthCmd + 1, sizeof(char));
+	if (running[pgCnt].job == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	lengthCmd = 0;
 	
 	//after memory is assigned, copy over the value of each argument to the running array element
 	while (cmd->argv[loop] != NULL){
@@ -568,7 +898,19 @@ void addToPG(int pid, Command* cmd){
 	//assign separator and status
 	running[pgCnt].separator = cmd->separator;
 	running[pgCnt].status = 'R';
+	running[pgCnt].termSignal = 0;
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	running[pgCnt].start = now.tv_sec * 1000000L + now.tv_nsec / 1000;
 	pgCnt++;
+	shareJob(pgCnt-1);
+	return 0;
+}
+
+void shareJob(int idx){
+	if (jobShareActive() == 0) return;
+	jobShareAdd(idx, pgCnt, running[idx].pid, running[idx].status, running[idx].separator, running[idx].start, running[idx].job);
 }
 
 void removeFromPG(int pid){
@@ -577,6 +919,7 @@ void removeFromPG(int pid){
 		if (running[i].pid == pid){
 			free(running[i].job);
 			//free existing char array
+			removeJobCgroup(pid);
 
 			//move each subsequent element after the deleted one forwards
 			for (int j=i; j<pgCnt-1; j++){
@@ -584,14 +927,21 @@ void removeFromPG(int pid){
 				running[j].job = running[j+1].job;
 				running[j].separator = running[j+1].separator;
 				running[j].status = running[j+1].status;
+				running[j].exitStatus = running[j+1].exitStatus;
+				running[j].termSignal = running[j+1].termSignal;
+				running[j].start = running[j+1].start;
 			}
 
 			//assign last element a nullptr
 			running[pgCnt-1].job = NULL;
-			break;
+			pgCnt--;
+
+			//remove it from the shared job table too, which may now have room for a job it could not hold before
+			jobShareRemove(i, pgCnt);
+			if (pgCnt >= JOBSHARE_CAPACITY) shareJob(JOBSHARE_CAPACITY-1);
+			return;
 		}
 	}
-	pgCnt--;
 }
 
 void clearPG(){
@@ -603,6 +953,18 @@ void clearPG(){
 	free(running);
 }
 
+void removeDoneJobs(){
+	//the handler changes the running array too, so it is held back while jobs are removed
+	sigset_t block, old;
+	sigemptyset(&block);
+	sigaddset(&block, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &block, &old);
+	for (int i=pgCnt-1; i>=0; i--){ //iterate from the back as elements are pushed forward once removed
+		if (running[i].status == 'D') removeFromPG(running[i].pid);
+	}
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
 void changeStatus(int childPID, char status){
 	int pos = -1; //tries to find the positino of the process that got continued/stopped in the running array
 	for (int i=0; i<pgCnt; i++){
@@ -621,18 +983,267 @@ void changeStatus(int childPID, char status){
 		} else if (status == 'S') {
 			running[pos].status = 'S';
 		}		
+		jobShareStatus(pos, running[pos].status);
+	}
+
+}
+
+int childState(int pid){
+	for (int i=0; i<pgCnt; i++){
+		if (running[i].pid == pid){
+			if (running[i].status == 'D'){
+				//the status is used up along with the job, as the pid may be recycled from now on
+				lastStatus = running[i].exitStatus;
+				lastSignal = running[i].termSignal;
+				removeFromPG(pid);
+				return 1;
+			} else if (running[i].status == 'S') {
+				lastStatus = 128 + SIGTSTP;
+				lastSignal = SIGTSTP;
+				return 0;
+			}
+			return -1;
+		}
+	}
+	//not a job, or one whose status was taken already, so there is nothing left to wait for
+	lastStatus = 127;
+	lastSignal = 0;
+	return 1;
+}
+
+int waitForChild(int pid){
+	//the signal handler is the only place children are reaped, so rather than calling waitpid here
+	//SIGCHLD is blocked and sigsuspend sleeps until the handler has run and changed the state of the child
+	sigset_t block, old, suspendMask;
+	int state;
+	sigemptyset(&block);
+	sigaddset(&block, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &block, &old);
+	//the caller may already have SIGCHLD blocked, so make sure it is deliverable while suspended
+	//the wait builtin holds SIGINT back the same way, so that it can't slip in before the suspend
+	suspendMask = old;
+	sigdelset(&suspendMask, SIGCHLD);
+	sigdelset(&suspendMask, SIGINT);
+
+	while ((state = childState(pid)) == -1 && interrupted == 0){
+		suspendForChild(&suspendMask);
+	}
+	
+	sigprocmask(SIG_SETMASK, &old, NULL);
+
+	//only the user ends the rest of the line, by stopping the child or interrupting it from the keyboard
+	//a child that crashed or was killed otherwise just leaves 128+signal, for && and || to act on
+	if (state == 0 || lastSignal == SIGINT || lastSignal == SIGQUIT) return 0;
+	return 1;
+}
+
+void waitForJobs(Command* cmd){
+	//SIGINT is held back along with SIGCHLD, so that it can only arrive while the wait is suspended
+	sigset_t block, old, suspendMask;
+	sigemptyset(&block);
+	sigaddset(&block, SIGCHLD);
+	sigaddset(&block, SIGINT);
+	sigprocmask(SIG_BLOCK, &block, &old);
+	suspendMask = old;
+	sigdelset(&suspendMask, SIGCHLD);
+	sigdelset(&suspendMask, SIGINT);
+	waiting = 1;
+	interrupted = 0;
+	
+	//snapshot the pids first, as job ids shift forward whenever a job is removed from the running array
+	int* pids = (int*) malloc(sizeof(int) * (pgCnt+1));
+	int pidCnt = 0;
+	if (pids == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	lastStatus = 0;
+
+	if (cmd->argc > 1 && strcmp(cmd->argv[1], "-n") == 0){
+		//wait -n, returns once any one of the current jobs is done, or right away if one is done already
+		int found = 0;
+		if (pgCnt == 0) {
+			printf("No jobs exist.\n");
+			lastStatus = 127;
+			found = 1;
+		}
+		while (found == 0 && interrupted == 0){
+			int live = 0;
+			for (int i=0; i<pgCnt && found == 0; i++){
+				if (running[i].status == 'D'){
+					childState(running[i].pid);
+					found = 1;
+				} else if (running[i].status == 'R') {
+					live = 1;
+				}
+			}
+
+			//stop if every job left is stopped, as none of them can terminate on its own
+			if (found == 0 && live == 0) break;
+			if (found == 0) suspendForChild(&suspendMask);
+		}
+	} else {
+		if (cmd->argc == 1){
+			//wait with no arguments waits on every job
+			for (int i=0; i<pgCnt; i++) pids[pidCnt++] = running[i].pid;
+		} else {
+			for (int i=1; i<cmd->argc; i++){
+				int jobID = parseJobID(cmd->argv[i]);
+				if (jobID <= 0 || jobID > pgCnt){
+					printf("Invalid job id specified: %s\n", cmd->argv[i]);
+					lastStatus = 127;
+				} else {
+					pids[pidCnt++] = running[jobID-1].pid;
+				}
+			}
+		}
+
+		//the exit status is the one of the last job waited on
+		for (int i=0; i<pidCnt && interrupted == 0; i++){
+			waitForChild(pids[i]);
+		}
+		if (cmd->argc == 1) lastStatus = 0;
+	}
+
+	//like in bash, a wait cut short by SIGINT returns 128+SIGINT
+	if (interrupted == 1){
+		printf("\n");
+		lastStatus = 128 + SIGINT;
+	}
+	waiting = 0;
+	interrupted = 0;
+	free(pids);
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+int suspendForChild(sigset_t* mask){
+	//timers keep running while the shell waits on a foreground job, their commands start in the background
+	if (suspendOrTimer(mask) == 0){
+		runDueTimers(launchTimer);
+		return 0;
+	}
+	return -1;
+}
+
+void launchTimer(Command* cmd){
+	if (pgCnt >= MAX_JOBS){
+		printf("Too many jobs, the timer command '%s' was not started.\n", cmd->path);
+		return;
+	}
+
+	//a timer may come due while a foreground job is waited on, with SIGCHLD and SIGINT blocked
+	//so the job is forked here with an empty mask, rather than through processInput which would pass that mask on
+	sigset_t block, old, none;
+	sigemptyset(&block);
+	sigaddset(&block, SIGCHLD);
+	sigemptyset(&none);
+	sigprocmask(SIG_BLOCK, &block, &old);
+	pid_t pid = fork();
+
+	if (pid == 0){
+		sigprocmask(SIG_SETMASK, &none, NULL);
+		setpgid(0, getpid());
+		applyLimits(&limits);
+		executeCommand(cmd);
+	} else if (pid < 0){
+		printf("Error executing command.\n");
+	} else {
+		setpgid(pid, pid);
+		traceEvent(TRACE_FORK, pid, pid, cmd->path);
+		if (addToPG(pid, cmd) == 0) printf("[%d] %d - %s\n", pgCnt, pid, running[pgCnt-1].job);
 	}
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
 
+int isBuiltin(char* name){
+	//the commands processInput runs in the shell process, timers only start jobs so they can't run these
+	char* builtins[] = {"helpme", "exit", "cd", "prompt", "pwd", "jobs", "after", "every", "cancel", "wait", "limit",
+		"pipesize", "pipemeter", "export", "unset", "argbatch", "jobshare", "trace", "fg", NULL};
+	for (int i=0; builtins[i] != NULL; i++){
+		if (strcmp(name, builtins[i]) == 0) return 1;
+	}
+	return (isAssignment(name) == 1) ? 1 : 0;
+}
+
+int readInputLine(char* out, int len){
+	//stdin is read with read(2) into lineBuf, so that poll sees all the input that is not used yet
+	//(stdio would read ahead into a buffer of its own that poll knows nothing about)
+	//returns 1 when a line was put in out, 0 if a timer or a signal interrupted the wait, -1 at end of file
+	while (1){
+		char* newline = memchr(lineBuf, '\n', lineCnt);
+		int take = (newline != NULL) ? newline - lineBuf + 1 : 0;
+		if (take == 0 && lineCnt == MAX_LENGTH_INPUT) take = lineCnt; //a line too long is cut, like fgets does
+		if (take > len-1) take = len-1;
+		if (take > 0){
+			memcpy(out, lineBuf, take);
+			out[take] = '\0';
+			lineCnt -= take;
+			memmove(lineBuf, lineBuf + take, lineCnt);
+			return 1;
+		}
+
+		int ready = waitForInputOrTimer(STDIN_FILENO);
+		if (ready == 0) runDueTimers(launchTimer);
+		if (ready != 1){
+			//no line is running at the prompt, so the jobs timers started that are done can go right away
+			//rather than piling up in the running array until a line is entered
+			removeDoneJobs();
+			return 0;
+		}
+
+		int n = read(STDIN_FILENO, lineBuf + lineCnt, MAX_LENGTH_INPUT - lineCnt);
+		if (n == -1) return (errno == EINTR) ? 0 : -1;
+		if (n == 0){
+			//the last line may not end with a newline, it is given one so that it is handled like the others
+			if (lineCnt == 0) return -1;
+			lineBuf[lineCnt++] = '\n';
+		} else {
+			lineCnt += n;
+		}
+	}
+}
+
+int parseJobID(char* arg){
+	int jobID = 0;
+
+	//loops through each character in the argument from the back to the front
+	//first, the character is converted to an int
+	//then it uses pow from the math library to exponentiate the value based on its place
+	//then adds that value to the final int jobID variable
+	for (int i=strlen(arg)-1; i>=0; i--){
+		if (arg[i] < '0' || arg[i] > '9') return -1;
+		int charToInt = (int) (arg[i] - '0');
+		jobID += charToInt * (int) pow(10, strlen(arg)-1-i);
+	}
+	return jobID;
 }
 
 void printHelp(){
 	printf("************************BUILT-IN COMMANDS************************\n");
 	printf("COMMAND\t\tDESCRIPTION\n");
 	printf("prompt <s>\tChanges the terminal prompt to <s>. To reset, enter the command without any arguments.\n");
+	printf("\t\t<s> may use \\u user, \\h host, \\w directory, \\W its last part, \\? last status, \\j jobs,\n");
+	printf("\t\t\\t duration of the last command, \\g git branch, \\n newline and \\\\ backslash.\n");
 	printf("pwd\t\tPrints the current working directory.\n");
 	printf("cd <s>\t\tChanges the current working directory to <s>. Accepts the use of wildcards.\n");
-	printf("jobs\t\tPrints out the list of currently running processes, along with their status. Does not accept arguments.\n");
+	printf("cd <t..>\tIf <t> is not a path, jumps to the most frequently and recently visited directory\n\t\tthat contains the terms <t> in order, the last one in its name. cd -l <t..> lists the matches.\n");
+	printf("jobs [-l]\tPrints out the list of currently running processes, along with their status. -l adds their resource usage.\n");
 	printf("fg <d>\t\tSets the process whose index matches <d> to run as the foreground process.\n");
+	printf("wait [d...]\tWaits for the jobs whose indexes are given, or for every job. 'wait -n' waits for the next job to finish.\n");
+	printf("limit [opts]\tLimits new jobs with cpu=<percent>, mem=<size> and pids=<n>, 'limit clear' removes them.\n");
+	printf("\t\t'limit <opts> -- <c>' only limits the command <c>, along with the rest of its pipeline.\n");
+	printf("trace <opt>\tRecords a timeline of jobs with 'trace on', writes it as a Chrome trace with 'trace save <file>'.\n");
+	printf("pipesize <s>\tSets the capacity of new pipes to <s> (i.e. 1M), 'default' resets it. 'a |=<s> b' sets one pipe.\n");
+	printf("pipemeter <o>\tWith 'on', prints the bytes and throughput of each pipeline stage once the pipeline ends.\n");
+	printf("argbatch <o>\tWith 'on', runs commands whose arguments exceed ARG_MAX in batches like xargs, <n> runs n at once.\n");
+	printf("jobshare <o>\tWith 'on', publishes the jobs in shared memory for external monitors such as jobview.\n");
+	printf("every <i> <c>\tRuns the command <c> in the background every <i> (i.e. 5, 1.5s, 500ms, 2m, 1h).\n");
+	printf("after <i> <c>\tRuns the command <c> in the background once, after <i>.\n");
+	printf("\t\tThe command <c> of every and after must be a program, not a builtin.\n");
+	printf("cancel <t>\tCancels the timer <t> of every or after, pending timers are listed by jobs.\n");
+	printf("a |+ b |+ c\tSends the output of a to both b and c, the last one may go on with '| d'.\n");
+	printf("a |*n b\t\tRuns n copies of b that get the lines of a in turn, |*no keeps the output in the order of the input.\n");
+	printf("NAME=value\tSets a shell variable, used in arguments as $NAME or ${NAME}. $? is the last status, $$ the shell pid.\n");
+	printf("export [n]\tPasses the variables <n> (or NAME=value) to commands, lists them without arguments.\n");
+	printf("unset <n>\tRemoves the variables <n>.\n");
+	printf("a && b, a || b\tRuns b only if a succeeded (&&) or failed (||).\n");
 	printf("exit\t\tTerminates the shell.\n");
 	printf("helpme\t\tPrint this guide again.\n");
 	printf("*****************************************************************\n");
@@ -0,0 +1,133 @@
+#define _GNU_SOURCE //needed for F_SETPIPE_SZ and splice
+#include "pipeline.h"
+
+int pipeSize = 0;
+int pipeMeter = 0;
+Meter* meters = NULL;
+int meterStage = 0;
+
+void setPipeSize(int fd, int size){
+	if (size <= 0) return;
+
+	//the kernel rounds the size up to a power of two pages, and refuses sizes above /proc/sys/fs/pipe-max-size
+	//for unprivileged users, in which case the pipe keeps its current capacity
+	fcntl(fd, F_SETPIPE_SZ, size);
+}
+
+Meter* createMeters(int stages){
+	Meter* m = mmap(NULL, sizeof(Meter) * stages, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (m == MAP_FAILED) return NULL;
+	return m; //anonymous mappings are zero filled
+}
+
+void reportMeters(Meter* m, int stages){
+	char size[50], rate[50];
+
+	//the last stage writes to the terminal or a file rather than a pipe, so it has no meter
+	for (int i=0; i<stages-1; i++){
+		if (m[i].name[0] == '\0') continue; //a consumer of a fan out that writes to stdout
+		long end = (m[i].end != 0) ? m[i].end : traceNow();
+		double seconds = (m[i].start != 0 && end > m[i].start) ? (end - m[i].start) / 1000000.0 : 0;
+
+		formatSize(m[i].bytes, size, 50);
+		formatSize((seconds > 0) ? m[i].bytes / seconds : 0, rate, 50);
+		printf("[stage %d] %s\t%s in %.3fs (%s/s)%s\n", i+1, m[i].name, size, seconds, rate,
+			(m[i].end == 0 && m[i].start != 0) ? ", still writing" : "");
+	}
+	munmap(m, sizeof(Meter) * stages);
+}
+
+void relayPipe(int fdIn, int fdOut, Meter* m){
+	//a downstream stage may exit early (i.e. head), which should end the relay quietly instead of killing it
+	signal(SIGPIPE, SIG_IGN);
+
+	//splice moves the pages between the two pipes inside the kernel, so metering adds no copy through user space
+	ssize_t res;
+	while ((res = splice(fdIn, NULL, fdOut, NULL, 1024*1024, SPLICE_F_MOVE)) > 0){
+		if (m->start == 0) m->start = traceNow();
+		m->bytes += res;
+	}
+	m->end = traceNow();
+
+	close(fdIn);
+	close(fdOut);
+}
+
+//writes all len bytes of buf to fd, returns -1 if the reader went away
+static int writeAll(int fd, char* buf, ssize_t len){
+	while (len > 0){
+		ssize_t res = write(fd, buf, len);
+		if (res == -1) return -1;
+		buf += res;
+		len -= res;
+	}
+	return 0;
+}
+
+void fanOutPipe(int fdIn, int* fdOut, int cnt, Meter* m){
+	signal(SIGPIPE, SIG_IGN); //consumers that exit early are dropped, the others keep receiving
+	ssize_t* done = (ssize_t*) malloc(sizeof(ssize_t) * cnt);
+	char* buf = NULL; //only allocated if a tee ever comes up short
+	if (done == NULL) {printf("Failure to allocate memory.\n"); _exit(1);}
+
+	while (cnt > 0){
+		//tee duplicates the pages at the head of fdIn into every consumer but the last without consuming them,
+		//then splice moves them into the last one, so the data never passes through user space
+		ssize_t n = (cnt == 1) ? splice(fdIn, NULL, fdOut[0], NULL, 1024*1024, 0) : tee(fdIn, fdOut[0], 1024*1024, 0);
+		if (n == -1 && errno == EPIPE){
+			close(fdOut[0]);
+			fdOut[0] = fdOut[--cnt];
+			continue;
+		}
+		if (n <= 0) break;
+		if (m != NULL){
+			if (m->start == 0) m->start = traceNow();
+			m->bytes += n;
+		}
+		if (cnt == 1) continue;
+
+		//tee always starts at the head of fdIn, so a consumer whose pipe had room for less than n bytes
+		//can't get the rest from another tee, instead those bytes are read once and written to it
+		int shortTee = 0, slowest = 0;
+		done[0] = n;
+		for (int i=1; i<cnt-1; i++){
+			done[i] = tee(fdIn, fdOut[i], n, 0); //-1 if the consumer is gone, which the write below detects
+			if (done[i] < n) shortTee = 1;
+			if (done[i] < done[slowest]) slowest = i;
+		}
+		done[cnt-1] = 0;
+
+		if (shortTee == 0){
+			ssize_t left = n, res = 0;
+			while (left > 0 && (res = splice(fdIn, NULL, fdOut[cnt-1], NULL, left, 0)) > 0) left -= res;
+			if (left == 0) continue;
+			done[cnt-1] = n - left; //the last consumer is gone, what it did not take is still in fdIn
+		}
+
+		int slowFd = fdOut[slowest]; //found by fd, as the writes may drop consumers and reorder fdOut
+		if (buf == NULL && (buf = (char*) malloc(1024*1024)) == NULL) {printf("Failure to allocate memory.\n"); _exit(1);}
+		ssize_t left = n - done[cnt-1];
+		if (read(fdIn, buf + done[cnt-1], left) != left) break;
+		for (int i=cnt-1; i>=0; i--){
+			ssize_t from = (done[i] > 0) ? done[i] : 0;
+			if (from < n && writeAll(fdOut[i], buf + from, n - from) == -1){
+				close(fdOut[i]);
+				fdOut[i] = fdOut[--cnt];
+				done[i] = done[cnt];
+			}
+		}
+		//the first tee sets n so it is never short, move the consumer that fell behind the most there
+		for (int i=1; i<cnt; i++){
+			if (fdOut[i] == slowFd){
+				fdOut[i] = fdOut[0];
+				fdOut[0] = slowFd;
+			}
+		}
+	}
+
+	if (m != NULL) m->end = traceNow();
+	for (int i=0; i<cnt; i++) close(fdOut[i]);
+	close(fdIn);
+	free(done);
+	free(buf);
+}
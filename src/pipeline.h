@@ -0,0 +1,49 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include "limit.h"
+#include "trace.h"
+
+#define METER_LENGTH_NAME 48
+
+//byte count of the output of one pipeline stage, written by the relay process that forwards it
+typedef struct StageMeter {
+	char name[METER_LENGTH_NAME];	// the command of the stage
+	long bytes;			// bytes the stage wrote to the next stage so far
+	long start;			// time of the first byte in microseconds, 0 if nothing was written
+	long end;			// time the stage closed its output, 0 while it is still writing
+} Meter;
+
+extern int pipeSize; //capacity given to every pipe with F_SETPIPE_SZ, 0 keeps the kernel default (64 KiB)
+extern int pipeMeter; //whether pipeline stages are metered, set with the pipemeter builtin
+extern Meter* meters; //meters of the pipeline being run, NULL if it is not metered
+extern int meterStage; //index of the stage pipeCommands is currently connecting
+
+//sets the capacity of the pipe fd belongs to, size 0 leaves it unchanged
+void setPipeSize(int fd, int size);
+
+//maps meters shared with the relays of a pipeline of the given number of stages, returns NULL on failure
+Meter* createMeters(int stages);
+
+//prints the bytes and throughput of every metered stage, then releases the meters
+void reportMeters(Meter* m, int stages);
+
+//forwards everything from fdIn to fdOut with splice, counting the bytes into m, used as the body of a relay process
+void relayPipe(int fdIn, int fdOut, Meter* m);
+
+//copies everything from fdIn to each of the cnt pipes in fdOut with tee and splice, counting the bytes into m
+//if it is not NULL, used as the body of the process behind a fan out (|+)
+void fanOutPipe(int fdIn, int* fdOut, int cnt, Meter* m);
+
+#endif
@@ -0,0 +1,204 @@
+#include "prompt.h"
+
+char homeCache[MAX_LENGTH_PROMPT], userCache[MAX_LENGTH_PROMPT], hostCache[MAX_LENGTH_PROMPT];
+char dirCache[MAX_LENGTH_PROMPT]; //current directory with the home directory replaced by ~, only updated by cd
+
+/*-------------VCS BRANCH WORKER-----------*/
+//the branch is looked up by a background thread, the prompt only reads the last result under the lock
+pthread_mutex_t branchLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t branchWake = PTHREAD_COND_INITIALIZER;
+int branchStarted = 0; //whether the worker thread was created, it is only started once \g is used
+int branchRequested = 0, branchComputed = 0; //generation asked for by the shell, and generation of the result
+char branchDir[MAX_LENGTH_PROMPT]; //directory the next lookup is for
+char branchName[MAX_LENGTH_PROMPT]; //result of the last lookup, empty if the directory is not in a repository
+char branchFound[MAX_LENGTH_PROMPT]; //directory the last lookup was for
+/*-----------------------------------------*/
+
+//reads the branch name of the git repository containing dir into name, or an empty string if there is none
+static void findBranch(char* dir, char* name, int len){
+	char path[MAX_LENGTH_PROMPT+20], head[MAX_LENGTH_PROMPT], search[MAX_LENGTH_PROMPT];
+	name[0] = '\0';
+	snprintf(search, MAX_LENGTH_PROMPT, "%s", dir);
+
+	//walk up from dir until a directory containing .git is found
+	while (1){
+		FILE* fp = NULL;
+		snprintf(path, sizeof(path), "%s/.git/HEAD", search);
+		fp = fopen(path, "r");
+		if (fp == NULL){
+			//worktrees and submodules have a .git file pointing to the real git directory instead
+			snprintf(path, sizeof(path), "%s/.git", search);
+			FILE* link = fopen(path, "r");
+			if (link != NULL){
+				if (fgets(head, MAX_LENGTH_PROMPT, link) != NULL && strncmp(head, "gitdir: ", 8) == 0){
+					head[strcspn(head, "\n")] = '\0';
+					int res;
+					if (head[8] == '/') res = snprintf(path, sizeof(path), "%s/HEAD", &head[8]);
+					else res = snprintf(path, sizeof(path), "%s/%s/HEAD", search, &head[8]);
+					if (res < (int) sizeof(path)) fp = fopen(path, "r");
+				}
+				fclose(link);
+			}
+		}
+
+		if (fp != NULL){
+			if (fgets(head, MAX_LENGTH_PROMPT, fp) != NULL){
+				head[strcspn(head, "\n")] = '\0';
+				//HEAD is either a symbolic ref to the branch, or the commit hash when detached
+				if (strncmp(head, "ref: refs/heads/", 16) == 0) snprintf(name, len, "%s", &head[16]);
+				else snprintf(name, len, "%.7s", head);
+			}
+			fclose(fp);
+			return;
+		}
+
+		char* slash = strrchr(search, '/');
+		if (slash == NULL || slash == search) return; //reached the root
+		*slash = '\0';
+	}
+}
+
+static void* branchWorker(void* arg){
+	char dir[MAX_LENGTH_PROMPT], name[MAX_LENGTH_PROMPT];
+
+	while (1){
+		pthread_mutex_lock(&branchLock);
+		while (branchRequested == branchComputed) pthread_cond_wait(&branchWake, &branchLock);
+		int generation = branchRequested;
+		strcpy(dir, branchDir);
+		pthread_mutex_unlock(&branchLock);
+
+		//the lookup itself runs without the lock, so the prompt never waits on the file system
+		findBranch(dir, name, MAX_LENGTH_PROMPT);
+
+		pthread_mutex_lock(&branchLock);
+		//a newer request may have come in meanwhile, in which case this result is already stale
+		if (generation == branchRequested){
+			strcpy(branchName, name);
+			strcpy(branchFound, dir);
+			branchComputed = generation;
+		}
+		pthread_mutex_unlock(&branchLock);
+	}
+	return NULL;
+}
+
+//asks the worker to look up the branch of the current directory again
+static void requestBranch(){
+	char cwd[MAX_LENGTH_PROMPT];
+	if (getcwd(cwd, MAX_LENGTH_PROMPT) == NULL) return;
+
+	pthread_mutex_lock(&branchLock);
+	strcpy(branchDir, cwd);
+	branchRequested++;
+	pthread_cond_signal(&branchWake);
+	pthread_mutex_unlock(&branchLock);
+}
+
+//starts the worker the first time the branch is needed
+static void startBranchWorker(){
+	pthread_t thread;
+	sigset_t all, old;
+
+	//signals are blocked in the worker so that they are always handled by the main thread
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	if (pthread_create(&thread, NULL, branchWorker, NULL) == 0){
+		pthread_detach(thread);
+		branchStarted = 1;
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (branchStarted == 1) requestBranch();
+}
+
+void updatePromptBranch(){
+	if (branchStarted == 1) requestBranch();
+}
+
+void initPrompt(char* home, char* user, char* host){
+	snprintf(homeCache, MAX_LENGTH_PROMPT, "%s", home);
+	snprintf(userCache, MAX_LENGTH_PROMPT, "%s", user);
+	snprintf(hostCache, MAX_LENGTH_PROMPT, "%s", host);
+	updatePromptDir();
+}
+
+void updatePromptDir(){
+	char cwd[MAX_LENGTH_PROMPT];
+	if (getcwd(cwd, MAX_LENGTH_PROMPT) == NULL) {
+		strcpy(dirCache, "?");
+		return;
+	}
+
+	//if the home directory is found at the start of the current directory, replace it with ~, just like the terminal
+	int homeLen = strlen(homeCache);
+	if (homeLen > 0 && strncmp(cwd, homeCache, homeLen) == 0 && (cwd[homeLen] == '/' || cwd[homeLen] == '\0')){
+		if (snprintf(dirCache, MAX_LENGTH_PROMPT, "~%s", &cwd[homeLen]) >= MAX_LENGTH_PROMPT) strcpy(dirCache, cwd);
+	} else {
+		strcpy(dirCache, cwd);
+	}
+
+	if (branchStarted == 1) requestBranch();
+}
+
+//appends str to out, never writing past len
+static void appendPrompt(char* out, int* pos, int len, char* str){
+	int res = snprintf(&out[*pos], len - *pos, "%s", str);
+	*pos += (res < len - *pos) ? res : len - *pos - 1;
+}
+
+void renderPrompt(char* format, int status, int jobs, long durationUsec, char* out, int len){
+	char segment[MAX_LENGTH_PROMPT];
+	int pos = 0;
+	out[0] = '\0';
+
+	for (int i=0; format[i] != '\0' && pos < len-1; i++){
+		if (format[i] != '\\' || format[i+1] == '\0'){
+			out[pos++] = format[i];
+			out[pos] = '\0';
+			continue;
+		}
+
+		i++;
+		segment[0] = '\0';
+		switch (format[i]){
+			case 'u': appendPrompt(out, &pos, len, userCache); break;
+			case 'h': appendPrompt(out, &pos, len, hostCache); break;
+			case 'w': appendPrompt(out, &pos, len, dirCache); break;
+			case 'W': {
+				char* slash = strrchr(dirCache, '/');
+				appendPrompt(out, &pos, len, (slash != NULL && slash[1] != '\0') ? &slash[1] : dirCache);
+				break;
+			}
+			case '?':
+				snprintf(segment, MAX_LENGTH_PROMPT, "%d", status);
+				appendPrompt(out, &pos, len, segment);
+				break;
+			case 'j':
+				snprintf(segment, MAX_LENGTH_PROMPT, "%d", jobs);
+				appendPrompt(out, &pos, len, segment);
+				break;
+			case 't':
+				if (durationUsec >= 1000000L) snprintf(segment, MAX_LENGTH_PROMPT, "%.2fs", durationUsec / 1000000.0);
+				else snprintf(segment, MAX_LENGTH_PROMPT, "%ldms", durationUsec / 1000);
+				appendPrompt(out, &pos, len, segment);
+				break;
+			case 'g':
+				if (branchStarted == 0) startBranchWorker();
+				//only take the result if it is for the current directory, otherwise leave it out for now
+				//while the branch of the same directory is looked up again, the previous one is still shown
+				pthread_mutex_lock(&branchLock);
+				if (branchComputed == branchRequested || strcmp(branchFound, branchDir) == 0) strcpy(segment, branchName);
+				pthread_mutex_unlock(&branchLock);
+				appendPrompt(out, &pos, len, segment);
+				break;
+			case 'n': appendPrompt(out, &pos, len, "\n"); break;
+			case '\\': appendPrompt(out, &pos, len, "\\"); break;
+			default:
+				//unknown escapes are printed as they are
+				segment[0] = '\\';
+				segment[1] = format[i];
+				segment[2] = '\0';
+				appendPrompt(out, &pos, len, segment);
+		}
+	}
+}
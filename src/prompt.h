@@ -0,0 +1,30 @@
+#ifndef PROMPT_H
+#define PROMPT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#define MAX_LENGTH_PROMPT 2000
+#define DEFAULT_PROMPT "\\u@\\h:\\w$" //the prompt used when none was set with the prompt builtin
+
+//stores the home directory, user and host shown by the prompt, and caches the current directory
+void initPrompt(char* home, char* user, char* host);
+
+//refreshes the cached current directory, must be called whenever the directory changes (i.e. by cd)
+void updatePromptDir();
+
+//asks for the VCS branch to be looked up again in the background, called after every command line
+//as a command may have switched branches, the prompt keeps showing the previous one until the lookup is done
+void updatePromptBranch();
+
+//expands the escapes in format into out, the supported escapes are
+//  \u user, \h host, \w current directory (with ~), \W its last component, \? last exit status,
+//  \j number of jobs, \t duration of the last command, \g VCS branch, \n newline and \\ backslash
+//the VCS branch is computed by a background thread, so it is left out until the thread has found it
+void renderPrompt(char* format, int status, int jobs, long durationUsec, char* out, int len);
+
+#endif
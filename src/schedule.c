@@ -0,0 +1,229 @@
+#define _GNU_SOURCE //needed for ppoll
+#include "schedule.h"
+#include <poll.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+
+//pending timers as a binary min heap on next, so adding and running a timer costs O(log n)
+//a single timerfd is always armed for the timer at the top of the heap
+Timer** heap = NULL;
+int heapCnt = 0, heapCap = 0;
+int timerFd = -1;
+int nextTimerID = 1;
+
+static long scheduleNow(){
+	struct timespec tp;
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000000000L + tp.tv_nsec;
+}
+
+static void swapTimers(int a, int b){
+	Timer* temp = heap[a];
+	heap[a] = heap[b];
+	heap[b] = temp;
+}
+
+static void siftUp(int i){
+	while (i > 0 && heap[(i-1)/2]->next > heap[i]->next){
+		swapTimers(i, (i-1)/2);
+		i = (i-1)/2;
+	}
+}
+
+static void siftDown(int i){
+	while (1){
+		int smallest = i, left = 2*i+1, right = 2*i+2;
+		if (left < heapCnt && heap[left]->next < heap[smallest]->next) smallest = left;
+		if (right < heapCnt && heap[right]->next < heap[smallest]->next) smallest = right;
+		if (smallest == i) return;
+		swapTimers(i, smallest);
+		i = smallest;
+	}
+}
+
+static void pushTimer(Timer* t){
+	if (heapCnt == heapCap){
+		heapCap = (heapCap == 0) ? 64 : heapCap * 2;
+		heap = (Timer**) realloc(heap, sizeof(Timer*) * heapCap);
+		if (heap == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	}
+	heap[heapCnt] = t;
+	heapCnt++;
+	siftUp(heapCnt-1);
+}
+
+static void removeTimerAt(int i){
+	heapCnt--;
+	if (i < heapCnt){
+		swapTimers(i, heapCnt);
+		siftUp(i);
+		siftDown(i);
+	}
+}
+
+static void freeTimer(Timer* t){
+	for (int i=0; i<t->cmd->argc; i++) free(t->cmd->argv[i]);
+	free(t->cmd->argv);
+	free(t->cmd->stdin_file);
+	free(t->cmd->stdout_file);
+	free(t->cmd);
+	free(t);
+}
+
+//arms the timerfd for the soonest timer, or disarms it when there are none
+static void armTimers(){
+	struct itimerspec its;
+	memset(&its, 0, sizeof(its));
+	if (heapCnt > 0){
+		//an absolute time of 0 would disarm the timer, which can't happen for a monotonic time after boot
+		its.it_value.tv_sec = heap[0]->next / 1000000000L;
+		its.it_value.tv_nsec = heap[0]->next % 1000000000L;
+	}
+	timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+int initTimers(){
+	//close on exec so that jobs don't inherit it, non blocking so that reading it never stalls the shell
+	timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	return (timerFd == -1) ? -1 : 0;
+}
+
+long parseInterval(char* arg){
+	char* end;
+	double value = strtod(arg, &end);
+	if (end == arg || value <= 0) return -1;
+
+	double unit = 1000000000.0; //seconds when no unit is given
+	if (strcmp(end, "ms") == 0) unit = 1000000.0;
+	else if (strcmp(end, "m") == 0) unit = 60 * 1000000000.0;
+	else if (strcmp(end, "h") == 0) unit = 3600 * 1000000000.0;
+	else if (strcmp(end, "s") != 0 && *end != '\0') return -1;
+
+	long ns = (long) (value * unit);
+	return (ns > 0) ? ns : -1;
+}
+
+int addTimer(long delay, long interval, Command* src, int first){
+	if (timerFd == -1 || first >= src->argc) return -1;
+
+	Timer* t = (Timer*) malloc(sizeof(Timer));
+	Command* cmd = (Command*) malloc(sizeof(Command));
+	if (t == NULL || cmd == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+
+	//copy the command, as the one it was typed in is freed once the input line has been processed
+	initializeCommand(cmd);
+	cmd->argc = src->argc - first;
+	cmd->argv = (char**) malloc(sizeof(char*) * (cmd->argc + 1));
+	if (cmd->argv == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	for (int i=0; i<cmd->argc; i++) cmd->argv[i] = strdup(src->argv[first+i]);
+	cmd->argv[cmd->argc] = NULL;
+	cmd->path = cmd->argv[0];
+	cmd->separator = '&';
+	cmd->batchFirst = (src->batchFirst - first > 1) ? src->batchFirst - first : 1;
+	cmd->batchLast = src->batchLast - first;
+	if (src->stdin_file != NULL) cmd->stdin_file = strdup(src->stdin_file);
+	if (src->stdout_file != NULL) cmd->stdout_file = strdup(src->stdout_file);
+
+	t->id = nextTimerID++;
+	t->interval = interval;
+	t->next = scheduleNow() + delay;
+	t->cmd = cmd;
+	pushTimer(t);
+	armTimers();
+	return t->id;
+}
+
+int cancelTimer(int id){
+	//cancel is rare next to adding and running timers, so the timer is looked up with a scan of the heap
+	for (int i=0; i<heapCnt; i++){
+		if (heap[i]->id == id){
+			Timer* t = heap[i];
+			removeTimerAt(i);
+			freeTimer(t);
+			armTimers();
+			return 0;
+		}
+	}
+	return -1;
+}
+
+int timerCount(){
+	return heapCnt;
+}
+
+static int compareTimers(const void* a, const void* b){
+	long diff = (*(Timer**) a)->next - (*(Timer**) b)->next;
+	return (diff > 0) - (diff < 0);
+}
+
+void printTimers(){
+	if (heapCnt == 0) return;
+
+	//the heap is only partially ordered, so sort a copy to list the timers soonest first
+	Timer** sorted = (Timer**) malloc(sizeof(Timer*) * heapCnt);
+	if (sorted == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	memcpy(sorted, heap, sizeof(Timer*) * heapCnt);
+	qsort(sorted, heapCnt, sizeof(Timer*), compareTimers);
+
+	long now = scheduleNow();
+	for (int i=0; i<heapCnt; i++){
+		Timer* t = sorted[i];
+		char every[50] = "after";
+		if (t->interval > 0) snprintf(every, 50, "every %gs", t->interval / 1000000000.0);
+
+		printf("[t%d]  %s, next in %.1fs\t-", t->id, every, (t->next > now) ? (t->next - now) / 1000000000.0 : 0);
+		for (int j=0; j<t->cmd->argc; j++) printf(" %s", t->cmd->argv[j]);
+		printf("\n");
+	}
+	free(sorted);
+}
+
+void runDueTimers(void (*launch)(Command* cmd)){
+	uint64_t expirations;
+	if (timerFd == -1) return;
+	if (read(timerFd, &expirations, sizeof(expirations)) == -1) {} //only clears the readable state
+
+	long now = scheduleNow();
+	while (heapCnt > 0 && heap[0]->next <= now){
+		//take the timer out of the heap before launching it, as the command itself may add or cancel timers
+		Timer* t = heap[0];
+		removeTimerAt(0);
+		launch(t->cmd);
+
+		if (t->interval > 0){
+			//runs missed while the shell was busy are skipped rather than started all at once
+			t->next += t->interval;
+			if (t->next <= now) t->next = now + t->interval;
+			pushTimer(t);
+		} else {
+			freeTimer(t);
+		}
+	}
+	armTimers();
+}
+
+int waitForInputOrTimer(int fd){
+	struct pollfd fds[2];
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = timerFd;
+	fds[1].events = POLLIN;
+
+	if (poll(fds, (timerFd == -1) ? 1 : 2, -1) == -1) return -1;
+	if (timerFd != -1 && (fds[1].revents & POLLIN)) return 0;
+	return 1; //readable, or at end of file, where the caller's read() then returns 0
+}
+
+int suspendOrTimer(sigset_t* mask){
+	if (timerFd == -1){
+		sigsuspend(mask);
+		return -1;
+	}
+
+	//ppoll swaps in the mask atomically like sigsuspend does, so a SIGCHLD can't slip in before it sleeps
+	struct pollfd fds;
+	fds.fd = timerFd;
+	fds.events = POLLIN;
+	if (ppoll(&fds, 1, NULL, mask) > 0) return 0;
+	return -1;
+}
@@ -0,0 +1,52 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#include "command.h"
+
+//a command started by the every or after builtins, kept in a min heap ordered by next
+typedef struct ScheduledTimer {
+	int id;				// number shown by jobs and used by cancel
+	long interval;		// nanoseconds between two runs, 0 for a timer that runs only once (after)
+	long next;			// CLOCK_MONOTONIC time of the next run in nanoseconds
+	Command* cmd;		// the command to run, always with the '&' separator
+} Timer;
+
+//creates the timerfd the timers are driven by, returns 0 on success, -1 otherwise
+int initTimers();
+
+//converts an interval such as 5, 1.5s, 500ms, 2m or 1h into nanoseconds, returns -1 if it is not valid
+long parseInterval(char* arg);
+
+//schedules the arguments of src from index first on (along with its redirections) to run after delay nanoseconds,
+//and every interval nanoseconds after that if interval is not 0
+//returns the id of the timer, or -1 if timers are not available
+int addTimer(long delay, long interval, Command* src, int first);
+
+//removes the timer with the given id, returns 0 on success, -1 if there is no such timer
+int cancelTimer(int id);
+
+//returns the number of pending timers
+int timerCount();
+
+//prints the pending timers, soonest first
+void printTimers();
+
+//runs launch for every timer that is due, then reschedules periodic timers and frees the others
+void runDueTimers(void (*launch)(Command* cmd));
+
+//blocks until fd has input, or a timer is due, or a signal arrives
+//returns 1 if fd has input, 0 if a timer is due, -1 if interrupted by a signal
+int waitForInputOrTimer(int fd);
+
+//like sigsuspend(mask), but also returns when a timer is due
+//returns 0 if a timer is due, -1 if it was woken by a signal
+int suspendOrTimer(sigset_t* mask);
+
+#endif
@@ -0,0 +1,284 @@
+#define _GNU_SOURCE //needed for pipe2 and memrchr
+#include "shard.h"
+#include <poll.h>
+
+//the engine runs in the process of the sharded stage, in place of the exec of that stage
+//it ends with _exit, which leaves the stdio buffer alone, so its errors are written with dprintf rather than printf
+ShardCopy* copies;
+int copyCnt = 0, ordered = 0;
+int fdShardIn = STDIN_FILENO, fdShardOut = STDOUT_FILENO;
+int lowestStatus = -1; //lowest exit status of the copies that terminated, -1 if none did yet
+int failedStatus = -1; //highest status of a copy that failed (killed by a signal or exited above 1), -1 if none did
+int outputClosed = 0; //set once the reader of the merged output went away
+long headSeq = 0; //ordered mode, chunk whose output is written out as it comes
+
+//writes all len bytes of buf to the merged output, stopping for good if the reader went away
+static void writeOutput(char* buf, long len){
+	while (len > 0 && outputClosed == 0){
+		ssize_t res = write(fdShardOut, buf, len);
+		if (res == -1 && errno == EINTR) continue;
+		if (res == -1){
+			outputClosed = 1;
+			return;
+		}
+		buf += res;
+		len -= res;
+	}
+}
+
+//forks a copy of the stage reading from and writing to pipes of its own
+static void startCopy(ShardCopy* c, Command* stage){
+	int toCopy[2], fromCopy[2];
+
+	//close on exec, so that a copy only keeps the two ends dup2 gives it rather than the pipes of the others
+	if (pipe2(toCopy, O_CLOEXEC) == -1 || pipe2(fromCopy, O_CLOEXEC) == -1){
+		dprintf(STDOUT_FILENO, "Error duplicating pipe.\n");
+		_exit(1);
+	}
+	setPipeSize(toCopy[1], pipeSize);
+	setPipeSize(fromCopy[1], pipeSize);
+
+	pid_t pid = fork();
+	if (pid == 0){
+		if (dup2(toCopy[0], STDIN_FILENO) == -1 || dup2(fromCopy[1], STDOUT_FILENO) == -1){
+			dprintf(STDOUT_FILENO, "Error duplicating file descriptor.\n");
+			_exit(1);
+		}
+		executeCommand(stage);
+	} else if (pid < 0){
+		dprintf(STDOUT_FILENO, "Error forking pipe.\n");
+		_exit(1);
+	}
+	traceEvent(TRACE_FORK, pid, getpgrp(), stage->path);
+	close(toCopy[0]);
+	close(fromCopy[1]);
+
+	//the engine serves every copy from one poll loop, so its ends never block
+	c->pid = pid;
+	c->in = toCopy[1];
+	c->out = fromCopy[0];
+	fcntl(c->in, F_SETFL, O_NONBLOCK);
+	fcntl(c->out, F_SETFL, O_NONBLOCK);
+}
+
+static void reapCopy(ShardCopy* c){
+	int status;
+	if (waitpid(c->pid, &status, 0) == c->pid){
+		int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+		if (lowestStatus == -1 || code < lowestStatus) lowestStatus = code;
+		if (code > 1 && code > failedStatus) failedStatus = code;
+	}
+	c->pid = 0;
+}
+
+//returns the slot the next chunk goes to, taking them in turn from next, or -1 if all of them are busy
+static int findIdle(int next){
+	for (int k=0; k<copyCnt; k++){
+		ShardCopy* c = &copies[(next+k) % copyCnt];
+		//a long running copy is ready once it took its last chunk, an ordered slot once its output was written
+		if (ordered == 0 && c->in != -1 && c->chunk == NULL) return (next+k) % copyCnt;
+		if (ordered == 1 && c->pid == 0) return (next+k) % copyCnt;
+	}
+	return -1;
+}
+
+//ordered mode, writes out every finished chunk from the head on, then what the new head produced so far
+static void advanceHead(){
+	while (1){
+		ShardCopy* head = NULL;
+		for (int i=0; i<copyCnt; i++){
+			if (copies[i].pid != 0 && copies[i].seq == headSeq) head = &copies[i];
+		}
+		if (head == NULL) return;
+
+		writeOutput(head->output, head->outputLen);
+		head->outputLen = 0;
+		if (head->out != -1) return; //still running, the rest of its output is written as it is read
+		reapCopy(head);
+		headSeq++;
+	}
+}
+
+//reads what the copy wrote, and writes it out unless it has to wait for earlier chunks
+static void readCopy(ShardCopy* c){
+	if (c->outputCap - c->outputLen < 64*1024){
+		c->outputCap = (c->outputCap == 0) ? 128*1024 : c->outputCap * 2;
+		c->output = (char*) realloc(c->output, c->outputCap);
+		if (c->output == NULL) {dprintf(STDOUT_FILENO, "Failure to allocate memory.\n"); _exit(1);}
+	}
+
+	ssize_t res = read(c->out, c->output + c->outputLen, c->outputCap - c->outputLen);
+	if (res == -1 && (errno == EAGAIN || errno == EINTR)) return;
+	if (res > 0) c->outputLen += res;
+
+	if (ordered == 0){
+		//only whole lines are written, so that the lines of two copies never end up mixed
+		//at end of file whatever is left goes out, even if it does not end with a newline
+		long len = c->outputLen;
+		if (res > 0){
+			char* newline = memrchr(c->output, '\n', c->outputLen);
+			len = (newline != NULL) ? newline - c->output + 1 : 0;
+		}
+		if (len > 0){
+			writeOutput(c->output, len);
+			memmove(c->output, c->output + len, c->outputLen - len);
+			c->outputLen -= len;
+		}
+	} else if (c->seq == headSeq){
+		writeOutput(c->output, c->outputLen);
+		c->outputLen = 0;
+	}
+
+	if (res <= 0){
+		//end of file, the copy is done
+		//a long running copy is reaped after the loop, as it may still run for a while after closing its output
+		close(c->out);
+		c->out = -1;
+		if (ordered == 1) advanceHead();
+	}
+}
+
+//writes as much of the pending chunk as the pipe of the copy takes
+static void feedCopy(ShardCopy* c){
+	ssize_t res = write(c->in, c->chunk + c->chunkOff, c->chunkLen - c->chunkOff);
+	if (res == -1 && (errno == EAGAIN || errno == EINTR)) return;
+
+	if (res > 0) c->chunkOff += res;
+	if (res == -1 || c->chunkOff == c->chunkLen){
+		//the lines of a copy that exited early (i.e. head) are dropped along with it
+		free(c->chunk);
+		c->chunk = NULL;
+		if (res == -1 || ordered == 1){
+			close(c->in);
+			c->in = -1;
+		}
+	}
+}
+
+int runShards(Command* stage){
+	if (stage->stdin_file != NULL && (fdShardIn = open(stage->stdin_file, O_RDONLY | O_CLOEXEC)) == -1){
+		dprintf(STDOUT_FILENO, "Error opening file.\n");
+		return 1;
+	}
+	if (stage->stdout_file != NULL && (fdShardOut = open(stage->stdout_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664)) == -1){
+		dprintf(STDOUT_FILENO, "Error opening file.\n");
+		return 1;
+	}
+	//the copies use the pipes of the engine instead
+	free(stage->stdin_file);
+	free(stage->stdout_file);
+	stage->stdin_file = stage->stdout_file = NULL;
+	signal(SIGPIPE, SIG_IGN); //a reader that exits early is noticed through EPIPE
+
+	copyCnt = stage->shards;
+	ordered = stage->shardOrdered;
+	long chunkSize = (ordered == 1) ? SHARD_ORDERED_CHUNK : SHARD_CHUNK;
+	copies = (ShardCopy*) calloc(copyCnt, sizeof(ShardCopy));
+	struct pollfd* fds = (struct pollfd*) malloc(sizeof(struct pollfd) * (2*copyCnt + 1));
+	ShardCopy** owners = (ShardCopy**) malloc(sizeof(ShardCopy*) * (2*copyCnt + 1));
+	long inCap = 2 * chunkSize, inLen = 0;
+	char* inBuf = (char*) malloc(inCap);
+	if (copies == NULL || fds == NULL || owners == NULL || inBuf == NULL) {dprintf(STDOUT_FILENO, "Failure to allocate memory.\n"); _exit(1);}
+
+	for (int i=0; i<copyCnt; i++){
+		copies[i].in = copies[i].out = -1;
+		if (ordered == 0) startCopy(&copies[i], stage); //the copies run for the whole stream
+	}
+
+	int inputDone = 0, next = 0;
+	long nextSeq = 0;
+	while (1){
+		//hand out whole lines to the copies in turn, an ordered chunk waits until it is full or the input ended
+		int idle;
+		while (inLen > 0 && (idle = findIdle(next)) != -1 && outputClosed == 0){
+			if (ordered == 1 && inLen < chunkSize && inputDone == 0) break;
+			//cut after the last line that fits into a chunk, or after the first line if it is longer than that
+			char* newline = memrchr(inBuf, '\n', (inLen < chunkSize) ? inLen : chunkSize);
+			if (newline == NULL) newline = memchr(inBuf, '\n', inLen);
+			if (newline == NULL && inputDone == 0) break; //the line goes on
+			long len = (newline != NULL) ? newline - inBuf + 1 : inLen;
+
+			ShardCopy* c = &copies[idle];
+			if (ordered == 1){
+				startCopy(c, stage);
+				c->seq = nextSeq++;
+			}
+			c->chunk = (char*) malloc(len);
+			if (c->chunk == NULL) {dprintf(STDOUT_FILENO, "Failure to allocate memory.\n"); _exit(1);}
+			memcpy(c->chunk, inBuf, len);
+			c->chunkLen = len;
+			c->chunkOff = 0;
+			memmove(inBuf, inBuf + len, inLen - len);
+			inLen -= len;
+			next = (idle + 1) % copyCnt;
+		}
+
+		//a line longer than the buffer makes it grow, as a line is never split between copies
+		if (inLen == inCap && memchr(inBuf, '\n', inLen) == NULL){
+			inCap *= 2;
+			inBuf = (char*) realloc(inBuf, inCap);
+			if (inBuf == NULL) {dprintf(STDOUT_FILENO, "Failure to allocate memory.\n"); _exit(1);}
+		}
+
+		//stop reading once no copy can take more lines, or nobody reads the output
+		int taking = 0;
+		for (int i=0; i<copyCnt; i++){
+			if (copies[i].in != -1 || ordered == 1) taking = 1;
+		}
+		if ((taking == 0 || outputClosed == 1) && inputDone == 0){
+			inputDone = 1;
+			inLen = 0;
+		}
+
+		//long running copies get end of file once the input ended and their last chunk was written
+		if (inputDone == 1 && inLen == 0){
+			for (int i=0; i<copyCnt; i++){
+				if (copies[i].in != -1 && copies[i].chunk == NULL){
+					close(copies[i].in);
+					copies[i].in = -1;
+				}
+			}
+		}
+
+		int nfds = 0;
+		if (inputDone == 0 && inLen < inCap){
+			fds[nfds].fd = fdShardIn;
+			fds[nfds].events = POLLIN;
+			owners[nfds++] = NULL;
+		}
+		for (int i=0; i<copyCnt; i++){
+			if (copies[i].chunk != NULL){
+				fds[nfds].fd = copies[i].in;
+				fds[nfds].events = POLLOUT;
+				owners[nfds++] = &copies[i];
+			}
+			if (copies[i].out != -1){
+				fds[nfds].fd = copies[i].out;
+				fds[nfds].events = POLLIN;
+				owners[nfds++] = &copies[i];
+			}
+		}
+		if (nfds == 0) break;
+
+		if (poll(fds, nfds, -1) == -1) continue;
+		for (int i=0; i<nfds; i++){
+			if (fds[i].revents == 0) continue;
+			if (owners[i] == NULL){
+				ssize_t res = read(fdShardIn, inBuf + inLen, inCap - inLen);
+				if (res > 0) inLen += res;
+				else if (res == 0 || errno != EINTR) inputDone = 1;
+			} else if (fds[i].events == POLLOUT){
+				feedCopy(owners[i]);
+			} else {
+				readCopy(owners[i]);
+			}
+		}
+	}
+
+	//the long running copies, along with those cut off by a reader that went away, are reaped once all output is out
+	for (int i=0; i<copyCnt; i++){
+		if (copies[i].pid != 0) reapCopy(&copies[i]);
+	}
+	if (failedStatus != -1) return failedStatus;
+	return (lowestStatus == -1) ? 0 : lowestStatus;
+}
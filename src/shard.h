@@ -0,0 +1,38 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "command.h"
+
+#define MAX_SHARDS 1024 //most copies a stage can be split across with |*<n>
+#define SHARD_CHUNK 64*1024 //lines handed to a long running copy at a time, at most
+#define SHARD_ORDERED_CHUNK 1024*1024 //lines given to each copy in ordered mode, which starts a copy per chunk
+
+//one copy of a sharded stage, along with the lines it is being fed and the output it produced
+typedef struct ShardCopy {
+	pid_t pid;			// 0 while no copy runs in this slot
+	int in;				// write end of the pipe to its stdin, -1 once closed
+	int out;			// read end of the pipe from its stdout, -1 once it reached end of file
+	char* chunk;		// whole lines waiting to be written to in, NULL if there are none
+	long chunkLen, chunkOff;
+	char* output;		// output read from out but not written yet
+	long outputLen, outputCap;
+	long seq;			// ordered mode, index of the chunk the copy runs on
+} ShardCopy;
+
+//runs the stage as stage->shards copies fed whole lines from stdin in turn, merging their output into stdout
+//the lines of every copy are kept whole, and with shardOrdered the output keeps the order of the input
+//returns the status of the worst failure if a copy was killed by a signal or exited above 1 (the highest such status)
+//and the lowest exit status of the copies otherwise, so that a stage of grep still gives 0 if any copy matched
+int runShards(Command* stage);
+
+#endif
@@ -0,0 +1,153 @@
+#include "trace.h"
+
+//the buffer is a header followed by the events, mapped MAP_SHARED so that children record into the same memory
+typedef struct TraceBuffer {
+	long start;			// time at which recording started, event timestamps are written relative to it
+	int shellPID;		// pid of the shell, used as the process id of the whole timeline
+	volatile int count;	// number of slots claimed so far, may exceed TRACE_CAPACITY once events are dropped
+	TraceEvent events[];
+} TraceBuffer;
+
+TraceBuffer* traceBuf = NULL; //NULL when tracing is off
+
+long traceNow(){
+	struct timespec tp;
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000000L + tp.tv_nsec / 1000;
+}
+
+int traceStart(){
+	traceStop();
+
+	TraceBuffer* buf = mmap(NULL, sizeof(TraceBuffer) + sizeof(TraceEvent) * TRACE_CAPACITY,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) return -1;
+
+	//anonymous mappings are zero filled, so every event starts with type 0 (not written yet)
+	buf->start = traceNow();
+	buf->shellPID = getpid();
+	buf->count = 0;
+	traceBuf = buf;
+	return 0;
+}
+
+void traceStop(){
+	if (traceBuf == NULL) return;
+
+	//clear the global first so that a signal handler running in between sees tracing as off
+	TraceBuffer* buf = traceBuf;
+	traceBuf = NULL;
+	munmap(buf, sizeof(TraceBuffer) + sizeof(TraceEvent) * TRACE_CAPACITY);
+}
+
+void traceEvent(char type, int pid, int group, char* name){
+	TraceBuffer* buf = traceBuf;
+	if (buf == NULL) return;
+
+	//claim a slot with an atomic add, so no lock is needed between the shell, its handler and its children
+	int slot = __atomic_fetch_add(&buf->count, 1, __ATOMIC_RELAXED);
+	if (slot >= TRACE_CAPACITY) return;
+
+	TraceEvent* ev = &buf->events[slot];
+	ev->ts = traceNow();
+	ev->pid = pid;
+	ev->group = group;
+	if (name != NULL) {
+		strncpy(ev->name, name, TRACE_LENGTH_NAME-1);
+		ev->name[TRACE_LENGTH_NAME-1] = '\0';
+	}
+	__atomic_store_n(&ev->type, type, __ATOMIC_RELEASE);
+}
+
+//writes a string as a JSON string literal
+static void writeJSONString(FILE* fp, char* str){
+	fputc('"', fp);
+	for (int i=0; str[i] != '\0'; i++){
+		if (str[i] == '"' || str[i] == '\\') fputc('\\', fp);
+		if ((unsigned char) str[i] >= ' ') fputc(str[i], fp);
+	}
+	fputc('"', fp);
+}
+
+//per pid summary of the recorded events, used to close the span started by each fork
+typedef struct TracePid {
+	int pid;			// 0 if the slot is empty
+	long reap;			// time the process was reaped, -1 if it never was
+	int exec;			// index of the last exec event of the process, -1 if there was none
+} TracePid;
+
+//finds the slot of pid in an open addressing table of size len (a power of two)
+static TracePid* tracePidSlot(TracePid* table, int len, int pid){
+	int i = (pid * 2654435761u) & (len-1);
+	while (table[i].pid != 0 && table[i].pid != pid) i = (i+1) & (len-1);
+	if (table[i].pid == 0){
+		table[i].pid = pid;
+		table[i].reap = -1;
+		table[i].exec = -1;
+	}
+	return &table[i];
+}
+
+int traceSave(char* file){
+	TraceBuffer* buf = traceBuf;
+	if (buf == NULL) return -2;
+
+	int count = __atomic_load_n(&buf->count, __ATOMIC_ACQUIRE);
+	if (count > TRACE_CAPACITY) count = TRACE_CAPACITY;
+	long end = traceNow();
+	int written = 0;
+
+	//summarize the events per pid first, so that writing the spans stays linear in the number of events
+	int len = 1;
+	while (len < count*2) len *= 2;
+	TracePid* table = (TracePid*) calloc(len, sizeof(TracePid));
+	if (table == NULL) return -1;
+	for (int i=0; i<count; i++){
+		TraceEvent* ev = &buf->events[i];
+		char type = __atomic_load_n(&ev->type, __ATOMIC_ACQUIRE);
+		if (type == TRACE_REAP && tracePidSlot(table, len, ev->pid)->reap == -1) tracePidSlot(table, len, ev->pid)->reap = ev->ts;
+		if (type == TRACE_EXEC) tracePidSlot(table, len, ev->pid)->exec = i;
+	}
+
+	FILE* fp = fopen(file, "w");
+	if (fp == NULL) {
+		free(table);
+		return -1;
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"shell\"}}", buf->shellPID);
+
+	for (int i=0; i<count; i++){
+		TraceEvent* ev = &buf->events[i];
+		char type = __atomic_load_n(&ev->type, __ATOMIC_ACQUIRE);
+		if (type == 0) continue; //slot claimed but not written yet
+
+		if (type == TRACE_FORK){
+			//each process is drawn as one span on its own row, from its fork to its reap, named after what it exec'd
+			//processes of a pipeline are reaped by the pipeline instead of the shell, so if a process
+			//was never reaped itself, its span ends when the leader of its process group was reaped
+			TracePid* self = tracePidSlot(table, len, ev->pid);
+			long finish = self->reap;
+			if (finish == -1) finish = tracePidSlot(table, len, ev->group)->reap;
+			if (finish == -1) finish = end;
+			char* name = (self->exec != -1) ? buf->events[self->exec].name : ev->name;
+
+			fprintf(fp, ",\n{\"name\":");
+			writeJSONString(fp, name);
+			fprintf(fp, ",\"cat\":\"job\",\"ph\":\"X\",\"ts\":%ld,\"dur\":%ld,\"pid\":%d,\"tid\":%d,\"args\":{\"pgid\":%d}}",
+				ev->ts - buf->start, finish - ev->ts, buf->shellPID, ev->pid, ev->group);
+		} else {
+			//exec, stop, continue and reap are drawn as instant events on the row of the process
+			char* label = (type == TRACE_EXEC) ? "exec" : (type == TRACE_STOP) ? "stop" : (type == TRACE_CONT) ? "continue" : "reap";
+			fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%ld,\"pid\":%d,\"tid\":%d}",
+				label, ev->ts - buf->start, buf->shellPID, ev->pid);
+		}
+		written++;
+	}
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	free(table);
+	return written;
+}
@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#define TRACE_CAPACITY 64*1024 //number of events kept, later events are dropped
+#define TRACE_LENGTH_NAME 48
+
+//the event types recorded
+#define TRACE_FORK 'F'
+#define TRACE_EXEC 'E'
+#define TRACE_STOP 'S'
+#define TRACE_CONT 'C'
+#define TRACE_REAP 'R'
+
+typedef struct TraceEvent {
+	long ts;			// microseconds since the monotonic clock's epoch
+	int pid;			// the process the event is about
+	int group;			// process group of the job the process belongs to
+	char name[TRACE_LENGTH_NAME]; // the command name, only recorded for fork and exec events
+	volatile char type; // one of the TRACE_ types, written last so a half written event is never read
+} TraceEvent;
+
+//returns the time of a monotonic clock in microseconds, used for every timestamp of the trace
+long traceNow();
+
+//starts recording into a buffer shared with every child forked afterwards, clears any previous events
+//returns 0 on success, -1 if the buffer could not be mapped
+int traceStart();
+
+//stops recording and releases the buffer
+void traceStop();
+
+//records an event, safe to call from a signal handler and from forked children
+//name can be NULL when the event has no command associated with it
+void traceEvent(char type, int pid, int group, char* name);
+
+//writes the recorded events to file in the Chrome trace event (JSON) format
+//returns the number of events written, -1 if the file could not be opened, or -2 if tracing is off
+int traceSave(char* file);
+
+#endif
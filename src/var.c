@@ -0,0 +1,243 @@
+#include "var.h"
+
+extern char** environ;
+
+Variable** buckets = NULL;
+int bucketCnt = 0, varCnt = 0;
+
+//the environment of the shell and its jobs, rebuilt only when an exported variable changes so that exec
+//gets it as is, instead of a new vector being put together for every command
+char** envVector = NULL;
+
+//FNV-1a hash of the first len characters of name
+static unsigned int hashName(char* name, int len){
+	unsigned int hash = 2166136261u;
+	for (int i=0; i<len; i++){
+		hash ^= (unsigned char) name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static Variable* findVariable(char* name, int len){
+	for (Variable* v = buckets[hashName(name, len) & (bucketCnt-1)]; v != NULL; v = v->next){
+		if (strncmp(v->name, name, len) == 0 && v->name[len] == '\0') return v;
+	}
+	return NULL;
+}
+
+//doubles the number of buckets once there are more variables than 3/4 of them, to keep the chains short
+static void growBuckets(){
+	int oldCnt = bucketCnt;
+	Variable** old = buckets;
+
+	bucketCnt = (oldCnt == 0) ? VAR_BUCKETS : oldCnt * 2;
+	buckets = (Variable**) calloc(bucketCnt, sizeof(Variable*));
+	if (buckets == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+
+	for (int i=0; i<oldCnt; i++){
+		Variable* v = old[i];
+		while (v != NULL){
+			Variable* next = v->next;
+			unsigned int idx = hashName(v->name, strlen(v->name)) & (bucketCnt-1);
+			v->next = buckets[idx];
+			buckets[idx] = v;
+			v = next;
+		}
+	}
+	free(old);
+}
+
+//collects the entries of the exported variables into a new envVector, and makes it the environment
+static void rebuildEnvironment(){
+	int cnt = 0;
+	for (int i=0; i<bucketCnt; i++){
+		for (Variable* v = buckets[i]; v != NULL; v = v->next){
+			if (v->entry != NULL) cnt++;
+		}
+	}
+
+	char** env = (char**) malloc(sizeof(char*) * (cnt+1));
+	if (env == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	cnt = 0;
+	for (int i=0; i<bucketCnt; i++){
+		for (Variable* v = buckets[i]; v != NULL; v = v->next){
+			if (v->entry != NULL) env[cnt++] = v->entry;
+		}
+	}
+	env[cnt] = NULL;
+
+	//getenv, execvp and the children forked from now on all read environ
+	environ = env;
+	free(envVector);
+	envVector = env;
+}
+
+//builds the "name=value" entry of an exported variable
+static void buildEntry(Variable* v){
+	free(v->entry);
+	v->entry = (char*) malloc(strlen(v->name) + strlen(v->value) + 2);
+	if (v->entry == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	sprintf(v->entry, "%s=%s", v->name, v->value);
+}
+
+static Variable* addVariable(char* name, int len, char* value){
+	if (varCnt >= bucketCnt * 3 / 4) growBuckets();
+
+	Variable* v = (Variable*) malloc(sizeof(Variable));
+	if (v == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	v->name = strndup(name, len);
+	v->value = strdup(value);
+	v->entry = NULL;
+
+	unsigned int idx = hashName(name, len) & (bucketCnt-1);
+	v->next = buckets[idx];
+	buckets[idx] = v;
+	varCnt++;
+	return v;
+}
+
+void initVariables(){
+	char** env = environ;
+	growBuckets();
+	for (int i=0; env[i] != NULL; i++){
+		char* equals = strchr(env[i], '=');
+		if (equals == NULL || findVariable(env[i], equals - env[i]) != NULL) continue;
+		Variable* v = addVariable(env[i], equals - env[i], equals+1);
+		buildEntry(v);
+	}
+	rebuildEnvironment();
+}
+
+void setVariable(char* name, char* value){
+	Variable* v = findVariable(name, strlen(name));
+	if (v == NULL){
+		addVariable(name, strlen(name), value);
+		return;
+	}
+
+	free(v->value);
+	v->value = strdup(value);
+	if (v->entry != NULL){
+		buildEntry(v);
+		rebuildEnvironment(); //the old entry was freed, so environ must not keep pointing at it
+	}
+}
+
+void exportVariable(char* name){
+	Variable* v = findVariable(name, strlen(name));
+	if (v == NULL) v = addVariable(name, strlen(name), "");
+	if (v->entry != NULL) return;
+	buildEntry(v);
+	rebuildEnvironment();
+}
+
+int unsetVariable(char* name){
+	Variable** link = &buckets[hashName(name, strlen(name)) & (bucketCnt-1)];
+	while (*link != NULL && strcmp((*link)->name, name) != 0) link = &(*link)->next;
+	if (*link == NULL) return -1;
+
+	Variable* v = *link;
+	*link = v->next;
+	varCnt--;
+	if (v->entry != NULL) rebuildEnvironment(); //drops it from the environment before its entry is freed
+	free(v->name);
+	free(v->value);
+	free(v->entry);
+	free(v);
+	return 0;
+}
+
+static int isNameChar(char c){
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') ? 1 : 0;
+}
+
+int isVariableName(char* name, int len){
+	if (len <= 0 || (name[0] >= '0' && name[0] <= '9')) return 0;
+	for (int i=0; i<len; i++){
+		if (isNameChar(name[i]) == 0) return 0;
+	}
+	return 1;
+}
+
+int isAssignment(char* arg){
+	char* equals = strchr(arg, '=');
+	return (equals != NULL && isVariableName(arg, equals - arg) == 1) ? 1 : 0;
+}
+
+//appends the first len characters of text to the expansion being built in buf
+static void appendText(char** buf, int* used, int* cap, char* text, int len){
+	if (*used + len + 1 > *cap){
+		while (*used + len + 1 > *cap) *cap *= 2;
+		*buf = (char*) realloc(*buf, *cap);
+		if (*buf == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	}
+	memcpy(*buf + *used, text, len);
+	*used += len;
+	(*buf)[*used] = '\0';
+}
+
+char* expandVariables(char* arg, int status){
+	int used = 0, cap = strlen(arg) + 64;
+	char* buf = (char*) malloc(cap);
+	char number[20];
+	if (buf == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	buf[0] = '\0';
+
+	int i = 0;
+	while (arg[i] != '\0'){
+		//copy everything up to the next $ in one go
+		int start = i;
+		while (arg[i] != '\0' && arg[i] != '$') i++;
+		appendText(&buf, &used, &cap, &arg[start], i - start);
+		if (arg[i] == '\0') break;
+
+		char* name = &arg[i+1];
+		int len = 0, skip = 0;
+		if (*name == '?' || *name == '$'){
+			snprintf(number, 20, "%d", (*name == '?') ? status : (int) getpid());
+			appendText(&buf, &used, &cap, number, strlen(number));
+			i += 2;
+			continue;
+		} else if (*name == '{'){
+			char* close = strchr(name, '}');
+			if (close != NULL && isVariableName(name+1, close - name - 1) == 1){
+				len = close - name - 1;
+				name++;
+				skip = 2;
+			}
+		} else if (!(*name >= '0' && *name <= '9')){
+			while (isNameChar(name[len]) == 1) len++;
+		}
+
+		if (len == 0){
+			//a $ that does not start a variable is kept as is
+			appendText(&buf, &used, &cap, "$", 1);
+			i++;
+			continue;
+		}
+		Variable* v = findVariable(name, len);
+		if (v != NULL) appendText(&buf, &used, &cap, v->value, strlen(v->value));
+		i += 1 + len + skip;
+	}
+	return buf;
+}
+
+static int compareNames(const void* a, const void* b){
+	return strcmp((*(Variable**) a)->name, (*(Variable**) b)->name);
+}
+
+void printExported(){
+	//the table is unordered, so sort the exported variables by name first
+	Variable** sorted = (Variable**) malloc(sizeof(Variable*) * (varCnt+1));
+	int cnt = 0;
+	if (sorted == NULL) {printf("Failure to allocate memory.\n"); exit(1);}
+	for (int i=0; i<bucketCnt; i++){
+		for (Variable* v = buckets[i]; v != NULL; v = v->next){
+			if (v->entry != NULL) sorted[cnt++] = v;
+		}
+	}
+	qsort(sorted, cnt, sizeof(Variable*), compareNames);
+	for (int i=0; i<cnt; i++) printf("export %s=%s\n", sorted[i]->name, sorted[i]->value);
+	free(sorted);
+}
@@ -0,0 +1,43 @@
+#ifndef VAR_H
+#define VAR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#define VAR_BUCKETS 256 //initial number of buckets of the variable table, doubled as it fills up
+
+//a shell variable, kept in a chained hash table on its name
+typedef struct ShellVariable {
+	char* name;
+	char* value;
+	char* entry;		// "name=value" as handed to exec, NULL unless the variable is exported
+	struct ShellVariable* next;	// next variable in the same bucket
+} Variable;
+
+//imports the environment of the shell as exported variables, must be called once at startup
+void initVariables();
+
+//sets the variable to value, it stays exported if it already was
+void setVariable(char* name, char* value);
+
+//exports the variable, creating it with an empty value if it is not set
+void exportVariable(char* name);
+
+//removes the variable, returns 0 on success, -1 if it was not set
+int unsetVariable(char* name);
+
+//returns 1 if the first len characters of name form a valid variable name, 0 otherwise
+int isVariableName(char* name, int len);
+
+//returns 1 if arg is an assignment such as NAME=value, 0 otherwise
+int isAssignment(char* arg);
+
+//returns a new string with $NAME, ${NAME}, $? (status) and $$ in arg replaced by their values
+char* expandVariables(char* arg, int status);
+
+//prints every exported variable as an export command
+void printExported();
+
+#endif